@@ -45,6 +45,12 @@ bool utils::has_xop()
 	return g_value;
 }
 
+bool utils::has_aesni()
+{
+	static const bool g_value = get_cpuid(0, 0)[0] >= 0x1 && get_cpuid(1, 0)[2] & 0x2000000;
+	return g_value;
+}
+
 std::string utils::get_system_info()
 {
 	std::string result;
@@ -28,6 +28,8 @@ namespace utils
 
 	bool has_xop();
 
+	bool has_aesni();
+
 	inline bool transaction_enter()
 	{
 		while (true)
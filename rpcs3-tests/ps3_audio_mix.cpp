@@ -0,0 +1,218 @@
+#include "stdafx.h"
+#include "Emu/Cell/Modules/cellAudioMix.h"
+
+#include <random>
+#include <chrono>
+
+// Scalar reference (the per-sample loops the SSE mixers replaced)
+template <bool Accumulate>
+static void audio_mix_2ch_ref(float* buf2ch, float* buf8ch, const be_t<f32>* buf, const float* levels)
+{
+	for (u32 i = 0; i < 2 * BUFFER_SIZE; i += 2)
+	{
+		const float m = levels[i / 2];
+
+		const float left = buf[i + 0] * m;
+		const float right = buf[i + 1] * m;
+
+		if (Accumulate)
+		{
+			buf2ch[i + 0] += left;
+			buf2ch[i + 1] += right;
+
+			buf8ch[i * 4 + 0] += left;
+			buf8ch[i * 4 + 1] += right;
+		}
+		else
+		{
+			buf2ch[i + 0] = left;
+			buf2ch[i + 1] = right;
+
+			buf8ch[i * 4 + 0] = left;
+			buf8ch[i * 4 + 1] = right;
+			buf8ch[i * 4 + 2] = 0.0f;
+			buf8ch[i * 4 + 3] = 0.0f;
+			buf8ch[i * 4 + 4] = 0.0f;
+			buf8ch[i * 4 + 5] = 0.0f;
+			buf8ch[i * 4 + 6] = 0.0f;
+			buf8ch[i * 4 + 7] = 0.0f;
+		}
+	}
+}
+
+template <bool Accumulate>
+static void audio_mix_8ch_ref(float* buf2ch, float* buf8ch, const be_t<f32>* buf, const float* levels)
+{
+	for (u32 i = 0; i < 2 * BUFFER_SIZE; i += 2)
+	{
+		const float m = levels[i / 2];
+
+		const float left = buf[i * 4 + 0] * m;
+		const float right = buf[i * 4 + 1] * m;
+		const float center = buf[i * 4 + 2] * m;
+		const float low_freq = buf[i * 4 + 3] * m;
+		const float rear_left = buf[i * 4 + 4] * m;
+		const float rear_right = buf[i * 4 + 5] * m;
+		const float side_left = buf[i * 4 + 6] * m;
+		const float side_right = buf[i * 4 + 7] * m;
+
+		const float mid = (center + low_freq) * 0.708f;
+		const float out_left = (left + rear_left + side_left + mid) * 1.0f;
+		const float out_right = (right + rear_right + side_right + mid) * 1.0f;
+
+		if (Accumulate)
+		{
+			buf2ch[i + 0] += out_left;
+			buf2ch[i + 1] += out_right;
+
+			buf8ch[i * 4 + 0] += left;
+			buf8ch[i * 4 + 1] += right;
+			buf8ch[i * 4 + 2] += center;
+			buf8ch[i * 4 + 3] += low_freq;
+			buf8ch[i * 4 + 4] += rear_left;
+			buf8ch[i * 4 + 5] += rear_right;
+			buf8ch[i * 4 + 6] += side_left;
+			buf8ch[i * 4 + 7] += side_right;
+		}
+		else
+		{
+			buf2ch[i + 0] = out_left;
+			buf2ch[i + 1] = out_right;
+
+			buf8ch[i * 4 + 0] = left;
+			buf8ch[i * 4 + 1] = right;
+			buf8ch[i * 4 + 2] = center;
+			buf8ch[i * 4 + 3] = low_freq;
+			buf8ch[i * 4 + 4] = rear_left;
+			buf8ch[i * 4 + 5] = rear_right;
+			buf8ch[i * 4 + 6] = side_left;
+			buf8ch[i * 4 + 7] = side_right;
+		}
+	}
+}
+
+// Input data and intermediate buffers for both implementations
+struct audio_mix_test_data
+{
+	std::vector<be_t<f32>> src;
+	alignas(16) float levels[BUFFER_SIZE];
+	alignas(16) float buf2ch[2][2 * BUFFER_SIZE];
+	alignas(16) float buf8ch[2][8 * BUFFER_SIZE];
+
+	audio_mix_test_data(u32 seed)
+		: src(8 * BUFFER_SIZE)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+
+		for (auto& value : src)
+		{
+			value = sample(rng);
+		}
+
+		// Odd levels: a ramp like the one of cellAudioSetPortLevel and values which aren't exact in binary
+		for (u32 i = 0; i < BUFFER_SIZE; i++)
+		{
+			levels[i] = i < BUFFER_SIZE / 2 ? 0.1f + i * 0.0031f : 1.0f / 3 + (i % 7) * 0.77f;
+		}
+
+		// The same garbage in both intermediate buffers (overwritten by the first mix, kept by accumulation)
+		for (u32 i = 0; i < 8 * BUFFER_SIZE; i++)
+		{
+			buf8ch[0][i] = buf8ch[1][i] = sample(rng);
+		}
+
+		for (u32 i = 0; i < 2 * BUFFER_SIZE; i++)
+		{
+			buf2ch[0][i] = buf2ch[1][i] = sample(rng);
+		}
+	}
+
+	void compare(const char* name) const
+	{
+		for (u32 i = 0; i < 2 * BUFFER_SIZE; i++)
+		{
+			if (std::memcmp(&buf2ch[0][i], &buf2ch[1][i], sizeof(float)) != 0)
+			{
+				TEST_FAILURE("%s: 2ch mismatch at %u (%g != %g)", name, i, buf2ch[0][i], buf2ch[1][i]);
+			}
+		}
+
+		for (u32 i = 0; i < 8 * BUFFER_SIZE; i++)
+		{
+			if (std::memcmp(&buf8ch[0][i], &buf8ch[1][i], sizeof(float)) != 0)
+			{
+				TEST_FAILURE("%s: 8ch mismatch at %u (%g != %g)", name, i, buf8ch[0][i], buf8ch[1][i]);
+			}
+		}
+	}
+};
+
+TEST_CLASS(audio_mix)
+{
+	TEST_METHOD(mix_2ch_first)
+	{
+		audio_mix_test_data data(1);
+		audio_mix_2ch<false>(data.buf2ch[0], data.buf8ch[0], data.src.data(), data.levels);
+		audio_mix_2ch_ref<false>(data.buf2ch[1], data.buf8ch[1], data.src.data(), data.levels);
+		data.compare("audio_mix_2ch<false>");
+	}
+
+	TEST_METHOD(mix_2ch_accumulate)
+	{
+		audio_mix_test_data data(2);
+		audio_mix_2ch<true>(data.buf2ch[0], data.buf8ch[0], data.src.data(), data.levels);
+		audio_mix_2ch_ref<true>(data.buf2ch[1], data.buf8ch[1], data.src.data(), data.levels);
+		data.compare("audio_mix_2ch<true>");
+	}
+
+	TEST_METHOD(mix_8ch_first)
+	{
+		audio_mix_test_data data(3);
+		audio_mix_8ch<false>(data.buf2ch[0], data.buf8ch[0], data.src.data(), data.levels);
+		audio_mix_8ch_ref<false>(data.buf2ch[1], data.buf8ch[1], data.src.data(), data.levels);
+		data.compare("audio_mix_8ch<false>");
+	}
+
+	TEST_METHOD(mix_8ch_accumulate)
+	{
+		audio_mix_test_data data(4);
+		audio_mix_8ch<true>(data.buf2ch[0], data.buf8ch[0], data.src.data(), data.levels);
+		audio_mix_8ch_ref<true>(data.buf2ch[1], data.buf8ch[1], data.src.data(), data.levels);
+		data.compare("audio_mix_8ch<true>");
+	}
+
+	// Microbenchmark: time of a full mixing period (one port of each kind), results are only logged
+	TEST_METHOD(mix_benchmark)
+	{
+		audio_mix_test_data data(5);
+
+		const u32 iterations = 20000;
+
+		auto measure = [&](auto&& mix)
+		{
+			const auto start = std::chrono::steady_clock::now();
+
+			for (u32 i = 0; i < iterations; i++)
+			{
+				mix();
+			}
+
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / iterations;
+		};
+
+		const auto sse = measure([&]()
+		{
+			audio_mix_2ch<false>(data.buf2ch[0], data.buf8ch[0], data.src.data(), data.levels);
+			audio_mix_8ch<true>(data.buf2ch[0], data.buf8ch[0], data.src.data(), data.levels);
+		});
+
+		const auto ref = measure([&]()
+		{
+			audio_mix_2ch_ref<false>(data.buf2ch[1], data.buf8ch[1], data.src.data(), data.levels);
+			audio_mix_8ch_ref<true>(data.buf2ch[1], data.buf8ch[1], data.src.data(), data.levels);
+		});
+
+		TEST_LOG("mixing period: %lld ns (scalar: %lld ns)\n", static_cast<long long>(sse), static_cast<long long>(ref));
+	}
+};
@@ -0,0 +1,173 @@
+#include "stdafx.h"
+#include "Crypto/aes.h"
+
+#include <random>
+
+// Known answers from FIPS-197 (appendix C) and NIST SP 800-38A (F.2)
+static const char* const s_ecb_plain = "00112233445566778899aabbccddeeff";
+static const char* const s_cbc_iv = "000102030405060708090a0b0c0d0e0f";
+static const char* const s_cbc_plain =
+	"6bc1bee22e409f96e93d7e117393172a" "ae2d8a571e03ac9c9eb76fac45af8e51"
+	"30c81c46a35ce411e5fbc1191a0a52ef" "f69f2445df4f9b17ad2b417be66c3710";
+
+static std::vector<u8> aes_test_hex(const char* str)
+{
+	std::vector<u8> result;
+
+	for (; str[0] && str[1]; str += 2)
+	{
+		result.push_back(static_cast<u8>(std::stoul(std::string(str, 2), nullptr, 16)));
+	}
+
+	return result;
+}
+
+// Run the operation with both implementations, check them against each other and the expected result
+template <typename F>
+static void aes_test_both_paths(const char* name, const std::vector<u8>& expected, F&& op)
+{
+	std::vector<u8> results[2];
+
+	for (int aesni = 0; aesni < 2; aesni++)
+	{
+		if (aes_use_aesni(aesni) != aesni)
+		{
+			TEST_LOG("%s: AES-NI is not supported by the CPU, only the table path is tested\n", name);
+			continue;
+		}
+
+		results[aesni] = op();
+
+		if (results[aesni] != expected && !expected.empty())
+		{
+			TEST_FAILURE("%s: wrong result (%s path)", name, aesni ? "AES-NI" : "table");
+		}
+	}
+
+	aes_use_aesni(1);
+
+	if (!results[1].empty() && results[0] != results[1])
+	{
+		TEST_FAILURE("%s: AES-NI and table paths differ", name);
+	}
+}
+
+static void aes_test_ecb(const char* name, const char* key, const char* cipher)
+{
+	const auto k = aes_test_hex(key);
+	const auto p = aes_test_hex(s_ecb_plain);
+	const auto c = aes_test_hex(cipher);
+
+	aes_test_both_paths(name, c, [&]()
+	{
+		aes_context ctx;
+		aes_setkey_enc(&ctx, k.data(), ::size32(k) * 8);
+
+		std::vector<u8> out(16);
+		aes_crypt_ecb(&ctx, AES_ENCRYPT, p.data(), out.data());
+		return out;
+	});
+
+	aes_test_both_paths(name, p, [&]()
+	{
+		aes_context ctx;
+		aes_setkey_dec(&ctx, k.data(), ::size32(k) * 8);
+
+		std::vector<u8> out(16);
+		aes_crypt_ecb(&ctx, AES_DECRYPT, c.data(), out.data());
+		return out;
+	});
+}
+
+static void aes_test_cbc(const char* name, const char* key, const char* cipher)
+{
+	const auto k = aes_test_hex(key);
+	const auto p = aes_test_hex(s_cbc_plain);
+	const auto c = aes_test_hex(cipher);
+
+	aes_test_both_paths(name, c, [&]()
+	{
+		aes_context ctx;
+		aes_setkey_enc(&ctx, k.data(), ::size32(k) * 8);
+
+		auto iv = aes_test_hex(s_cbc_iv);
+		std::vector<u8> out(p.size());
+		aes_crypt_cbc(&ctx, AES_ENCRYPT, p.size(), iv.data(), p.data(), out.data());
+		return out;
+	});
+
+	aes_test_both_paths(name, p, [&]()
+	{
+		aes_context ctx;
+		aes_setkey_dec(&ctx, k.data(), ::size32(k) * 8);
+
+		auto iv = aes_test_hex(s_cbc_iv);
+		std::vector<u8> out(c.size());
+		aes_crypt_cbc(&ctx, AES_DECRYPT, c.size(), iv.data(), c.data(), out.data());
+		return out;
+	});
+
+	// Longer random input: 4-block batches and the remainder, IV chaining between calls
+	std::mt19937 rng(::size32(k));
+	std::vector<u8> data(16 * 23);
+
+	for (auto& b : data)
+	{
+		b = static_cast<u8>(rng());
+	}
+
+	for (int mode : {AES_ENCRYPT, AES_DECRYPT})
+	{
+		aes_test_both_paths(name, {}, [&]()
+		{
+			aes_context ctx;
+			(mode == AES_ENCRYPT ? aes_setkey_enc : aes_setkey_dec)(&ctx, k.data(), ::size32(k) * 8);
+
+			auto iv = aes_test_hex(s_cbc_iv);
+			std::vector<u8> out(data.size());
+			aes_crypt_cbc(&ctx, mode, 16 * 7, iv.data(), data.data(), out.data());
+			aes_crypt_cbc(&ctx, mode, data.size() - 16 * 7, iv.data(), data.data() + 16 * 7, out.data() + 16 * 7);
+			out.insert(out.end(), iv.begin(), iv.end());
+			return out;
+		});
+	}
+}
+
+TEST_CLASS(crypto_aes)
+{
+	TEST_METHOD(ecb_128)
+	{
+		aes_test_ecb("ECB-AES128", "000102030405060708090a0b0c0d0e0f", "69c4e0d86a7b0430d8cdb78070b4c55a");
+	}
+
+	TEST_METHOD(ecb_192)
+	{
+		aes_test_ecb("ECB-AES192", "000102030405060708090a0b0c0d0e0f1011121314151617", "dda97ca4864cdfe06eaf70a0ec0d7191");
+	}
+
+	TEST_METHOD(ecb_256)
+	{
+		aes_test_ecb("ECB-AES256", "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", "8ea2b7ca516745bfeafc49904b496089");
+	}
+
+	TEST_METHOD(cbc_128)
+	{
+		aes_test_cbc("CBC-AES128", "2b7e151628aed2a6abf7158809cf4f3c",
+			"7649abac8119b246cee98e9b12e9197d" "5086cb9b507219ee95db113a917678b2"
+			"73bed6b8e3c1743b7116e69e22229516" "3ff1caa1681fac09120eca307586e1a7");
+	}
+
+	TEST_METHOD(cbc_192)
+	{
+		aes_test_cbc("CBC-AES192", "8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b",
+			"4f021db243bc633d7178183a9fa071e8" "b4d9ada9ad7dedf4e5e738763f69145a"
+			"571b242012fb7ae07fa9baac3df102e0" "08b0e27988598881d920a9e64f5615cd");
+	}
+
+	TEST_METHOD(cbc_256)
+	{
+		aes_test_cbc("CBC-AES256", "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4",
+			"f58c4c04d6e5f1ba779eabfb5f7bfbd6" "9cfc4e967edb808d679f777bc6702c7d"
+			"39f23369a9d9bacfa530e26304231461" "b2eb05e2c39be9fcda6c19078c6a9d1b");
+	}
+};
@@ -30,6 +30,7 @@
  */
 
 #include "aes.h"
+#include "Utilities/sysinfo.h"
 
 /*
  * 32-bit integer manipulation macros (little endian)
@@ -632,6 +633,212 @@ int aes_setkey_dec( aes_context *ctx, const unsigned char *key, unsigned int key
                  RT3[ ( Y0 >> 24 ) & 0xFF ];    \
 }
 
+/*
+ * AES-NI implementation
+ *
+ * The round keys produced by aes_setkey_enc() and aes_setkey_dec() already
+ * have the layout expected by AESENC and AESDEC (the decryption schedule is
+ * the "equivalent inverse cipher" one), so they are used as is.
+ */
+#ifdef _MSC_VER
+#define AESNI_FUNC static
+#else
+#define AESNI_FUNC static __attribute__((__target__("aes")))
+#endif
+
+static const bool aesni_supported = utils::has_aesni();
+
+// Can be cleared to force the table path (see aes_use_aesni)
+static bool aesni_enabled = aesni_supported;
+
+int aes_use_aesni( int enable )
+{
+    aesni_enabled = enable && aesni_supported;
+    return aesni_enabled;
+}
+
+AESNI_FUNC __m128i aesni_encrypt( const aes_context *ctx, __m128i x )
+{
+    const __m128i *RK = (const __m128i *) ctx->rk;
+
+    x = _mm_xor_si128( x, _mm_loadu_si128( RK ) );
+
+    for( int i = 1; i < ctx->nr; i++ )
+        x = _mm_aesenc_si128( x, _mm_loadu_si128( RK + i ) );
+
+    return( _mm_aesenclast_si128( x, _mm_loadu_si128( RK + ctx->nr ) ) );
+}
+
+AESNI_FUNC __m128i aesni_decrypt( const aes_context *ctx, __m128i x )
+{
+    const __m128i *RK = (const __m128i *) ctx->rk;
+
+    x = _mm_xor_si128( x, _mm_loadu_si128( RK ) );
+
+    for( int i = 1; i < ctx->nr; i++ )
+        x = _mm_aesdec_si128( x, _mm_loadu_si128( RK + i ) );
+
+    return( _mm_aesdeclast_si128( x, _mm_loadu_si128( RK + ctx->nr ) ) );
+}
+
+/*
+ * Four independent blocks at once, to hide the latency of AESENC/AESDEC
+ */
+AESNI_FUNC void aesni_encrypt4( const aes_context *ctx, __m128i x[4] )
+{
+    const __m128i *RK = (const __m128i *) ctx->rk;
+    __m128i k = _mm_loadu_si128( RK );
+
+    x[0] = _mm_xor_si128( x[0], k );
+    x[1] = _mm_xor_si128( x[1], k );
+    x[2] = _mm_xor_si128( x[2], k );
+    x[3] = _mm_xor_si128( x[3], k );
+
+    for( int i = 1; i < ctx->nr; i++ )
+    {
+        k = _mm_loadu_si128( RK + i );
+        x[0] = _mm_aesenc_si128( x[0], k );
+        x[1] = _mm_aesenc_si128( x[1], k );
+        x[2] = _mm_aesenc_si128( x[2], k );
+        x[3] = _mm_aesenc_si128( x[3], k );
+    }
+
+    k = _mm_loadu_si128( RK + ctx->nr );
+    x[0] = _mm_aesenclast_si128( x[0], k );
+    x[1] = _mm_aesenclast_si128( x[1], k );
+    x[2] = _mm_aesenclast_si128( x[2], k );
+    x[3] = _mm_aesenclast_si128( x[3], k );
+}
+
+AESNI_FUNC void aesni_decrypt4( const aes_context *ctx, __m128i x[4] )
+{
+    const __m128i *RK = (const __m128i *) ctx->rk;
+    __m128i k = _mm_loadu_si128( RK );
+
+    x[0] = _mm_xor_si128( x[0], k );
+    x[1] = _mm_xor_si128( x[1], k );
+    x[2] = _mm_xor_si128( x[2], k );
+    x[3] = _mm_xor_si128( x[3], k );
+
+    for( int i = 1; i < ctx->nr; i++ )
+    {
+        k = _mm_loadu_si128( RK + i );
+        x[0] = _mm_aesdec_si128( x[0], k );
+        x[1] = _mm_aesdec_si128( x[1], k );
+        x[2] = _mm_aesdec_si128( x[2], k );
+        x[3] = _mm_aesdec_si128( x[3], k );
+    }
+
+    k = _mm_loadu_si128( RK + ctx->nr );
+    x[0] = _mm_aesdeclast_si128( x[0], k );
+    x[1] = _mm_aesdeclast_si128( x[1], k );
+    x[2] = _mm_aesdeclast_si128( x[2], k );
+    x[3] = _mm_aesdeclast_si128( x[3], k );
+}
+
+AESNI_FUNC void aesni_crypt_ecb( aes_context *ctx,
+                                 int mode,
+                                 const unsigned char input[16],
+                                 unsigned char output[16] )
+{
+    const __m128i x = _mm_loadu_si128( (const __m128i *) input );
+
+    _mm_storeu_si128( (__m128i *) output, mode == AES_DECRYPT ? aesni_decrypt( ctx, x ) : aesni_encrypt( ctx, x ) );
+}
+
+AESNI_FUNC void aesni_crypt_cbc( aes_context *ctx,
+                                 int mode,
+                                 size_t length,
+                                 unsigned char iv[16],
+                                 const unsigned char *input,
+                                 unsigned char *output )
+{
+    const __m128i *in = (const __m128i *) input;
+    __m128i *out = (__m128i *) output;
+    __m128i prev = _mm_loadu_si128( (const __m128i *) iv );
+
+    if( mode == AES_DECRYPT )
+    {
+        // Decryption is parallel: all ciphertext blocks are known in advance
+        for( ; length >= 64; length -= 64, in += 4, out += 4 )
+        {
+            const __m128i c0 = _mm_loadu_si128( in + 0 );
+            const __m128i c1 = _mm_loadu_si128( in + 1 );
+            const __m128i c2 = _mm_loadu_si128( in + 2 );
+            const __m128i c3 = _mm_loadu_si128( in + 3 );
+
+            __m128i x[4] = { c0, c1, c2, c3 };
+            aesni_decrypt4( ctx, x );
+
+            _mm_storeu_si128( out + 0, _mm_xor_si128( x[0], prev ) );
+            _mm_storeu_si128( out + 1, _mm_xor_si128( x[1], c0 ) );
+            _mm_storeu_si128( out + 2, _mm_xor_si128( x[2], c1 ) );
+            _mm_storeu_si128( out + 3, _mm_xor_si128( x[3], c2 ) );
+            prev = c3;
+        }
+
+        for( ; length > 0; length -= 16, in++, out++ )
+        {
+            const __m128i c = _mm_loadu_si128( in );
+            _mm_storeu_si128( out, _mm_xor_si128( aesni_decrypt( ctx, c ), prev ) );
+            prev = c;
+        }
+    }
+    else
+    {
+        for( ; length > 0; length -= 16, in++, out++ )
+        {
+            prev = aesni_encrypt( ctx, _mm_xor_si128( _mm_loadu_si128( in ), prev ) );
+            _mm_storeu_si128( out, prev );
+        }
+    }
+
+    _mm_storeu_si128( (__m128i *) iv, prev );
+}
+
+/*
+ * Encrypts whole blocks of counter stream, returns the number of bytes processed
+ */
+AESNI_FUNC size_t aesni_crypt_ctr( aes_context *ctx,
+                                   size_t length,
+                                   unsigned char nonce_counter[16],
+                                   unsigned char stream_block[16],
+                                   const unsigned char *input,
+                                   unsigned char *output )
+{
+    size_t done = 0;
+    unsigned char counters[4][16];
+
+    for( ; length - done >= 64; done += 64 )
+    {
+        for( int j = 0; j < 4; j++ )
+        {
+            memcpy( counters[j], nonce_counter, 16 );
+
+            for( int i = 16; i > 0; i-- )
+                if( ++nonce_counter[i - 1] != 0 )
+                    break;
+        }
+
+        __m128i x[4];
+
+        for( int j = 0; j < 4; j++ )
+            x[j] = _mm_loadu_si128( (const __m128i *) counters[j] );
+
+        aesni_encrypt4( ctx, x );
+
+        for( int j = 0; j < 4; j++ )
+        {
+            const __m128i data = _mm_loadu_si128( (const __m128i *) ( input + done ) + j );
+            _mm_storeu_si128( (__m128i *) ( output + done ) + j, _mm_xor_si128( data, x[j] ) );
+        }
+
+        _mm_storeu_si128( (__m128i *) stream_block, x[3] );
+    }
+
+    return( done );
+}
+
 /*
  * AES-ECB block encryption/decryption
  */
@@ -643,6 +850,12 @@ int aes_crypt_ecb( aes_context *ctx,
     int i;
     uint32_t *RK, X0, X1, X2, X3, Y0, Y1, Y2, Y3;
 
+    if( aesni_enabled )
+    {
+        aesni_crypt_ecb( ctx, mode, input, output );
+        return( 0 );
+    }
+
     RK = ctx->rk;
 
     GET_UINT32_LE( X0, input,  0 ); X0 ^= *RK++;
@@ -743,6 +956,12 @@ int aes_crypt_cbc( aes_context *ctx,
     if( length % 16 )
         return( POLARSSL_ERR_AES_INVALID_INPUT_LENGTH );
 
+    if( aesni_enabled )
+    {
+        aesni_crypt_cbc( ctx, mode, length, iv, input, output );
+        return( 0 );
+    }
+
     if( mode == AES_DECRYPT )
     {
         while( length > 0 )
@@ -839,6 +1058,14 @@ int aes_crypt_ctr( aes_context *ctx,
     int c, i;
     size_t n = *nc_off;
 
+    if( aesni_enabled && n == 0 )
+    {
+        const size_t done = aesni_crypt_ctr( ctx, length, nonce_counter, stream_block, input, output );
+        input  += done;
+        output += done;
+        length -= done;
+    }
+
     while( length-- )
     {
         if( n == 0 ) {
@@ -174,6 +174,17 @@ int aes_crypt_ctr( aes_context *ctx,
 
 void aes_cmac(aes_context *ctx, int length, unsigned char *input, unsigned char *output);
 
+/**
+ * \brief          Select between the AES-NI path and the table path
+ *                 (not thread-safe, meant for tests)
+ *
+ * \param enable   0 to force the table path, otherwise AES-NI is used if
+ *                 the CPU supports it
+ *
+ * \return         1 if the AES-NI path is used
+ */
+int aes_use_aesni( int enable );
+
 #ifdef __cplusplus
 }
 #endif
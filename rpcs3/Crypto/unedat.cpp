@@ -940,40 +940,86 @@ bool EDATADecrypter::ReadHeader()
 	return true;
 }
 
+const std::vector<u8>* EDATADecrypter::GetBlock(u32 index)
+{
+	cached_block* victim = nullptr;
+
+	for (auto& block : block_cache)
+	{
+		if (block.index == index)
+		{
+			block.stamp = ++block_stamp;
+			return &block.data;
+		}
+
+		if (!victim || block.stamp < victim->stamp)
+		{
+			victim = &block;
+		}
+	}
+
+	if (block_cache.size() < block_cache_size)
+	{
+		block_cache.emplace_back();
+		victim = &block_cache.back();
+	}
+
+	// Reuse the least recently used entry
+	victim->data.resize(edatHeader.block_size);
+
+	edata_file.seek(0);
+	const s64 res = decrypt_block(&edata_file, victim->data.data(), &edatHeader, &npdHeader, dec_key.data(), index, total_blocks, edatHeader.file_size);
+
+	if (res == -1)
+	{
+		victim->index = -1;
+		victim->stamp = 0;
+		return nullptr;
+	}
+
+	victim->data.resize(res);
+	victim->index = index;
+	victim->stamp = ++block_stamp;
+	return &victim->data;
+}
+
 u64 EDATADecrypter::ReadData(u64 pos, u8* data, u64 size)
 {
 	if (pos > edatHeader.file_size)
 		return 0;
 
-	// now we need to offset things to account for the actual 'range' requested
-	const u64 startOffset = pos % edatHeader.block_size;
+	// serve the requested range block by block, decrypting only blocks missing from the cache
+	u64 bytesWrote = 0;
 
-	const u32 num_blocks = static_cast<u32>(std::ceil((startOffset + size) / (double)edatHeader.block_size));
-	const u64 bufSize = num_blocks*edatHeader.block_size;
-	if (data_buf_size < (bufSize))
+	while (bytesWrote < size)
 	{
-		data_buf.reset(new u8[bufSize]);
-		data_buf_size = bufSize;
-	}
+		const u64 offset = pos + bytesWrote;
+		const u32 index = static_cast<u32>(offset / edatHeader.block_size);
 
-	// find and decrypt block range covering pos + size
-	const u32 starting_block = static_cast<u32>(pos / edatHeader.block_size);
-	const u32 ending_block = std::min(starting_block + num_blocks, total_blocks);
-	u64 writeOffset = 0;
-	for (u32 i = starting_block; i < ending_block; ++i)
-	{
-		edata_file.seek(0);
-		u64 res = decrypt_block(&edata_file, &data_buf[writeOffset], &edatHeader, &npdHeader, dec_key.data(), i, total_blocks, edatHeader.file_size);
-		if (res == -1)
+		if (index >= total_blocks)
+		{
+			break;
+		}
+
+		const auto block = GetBlock(index);
+
+		if (!block)
 		{
 			LOG_ERROR(LOADER, "Error Decrypting data");
 			return 0;
 		}
-		writeOffset += res;
-	}
 
-	const u64 bytesWrote = std::min<u64>(writeOffset - startOffset, size);
+		const u64 block_offset = offset % edatHeader.block_size;
+
+		if (block_offset >= block->size())
+		{
+			break;
+		}
+
+		const u64 count = std::min<u64>(block->size() - block_offset, size - bytesWrote);
+		std::memcpy(data + bytesWrote, block->data() + block_offset, count);
+		bytesWrote += count;
+	}
 
-	memcpy(data, &data_buf[startOffset], bytesWrote);
 	return bytesWrote;
 }
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <array>
+#include <vector>
 
 #include "utils.h"
 
@@ -59,9 +60,18 @@ struct EDATADecrypter final : fs::file_base
 	NPD_HEADER npdHeader;
 	EDAT_HEADER edatHeader;
 
-	// Internal data buffers.
-	std::unique_ptr<u8[]> data_buf;
-	u64 data_buf_size{0};
+	// Decrypted block cache (LRU), shared by all views of the file
+	struct cached_block
+	{
+		u32 index;
+		u64 stamp;
+		std::vector<u8> data;
+	};
+
+	static constexpr u32 block_cache_size = 32;
+
+	std::vector<cached_block> block_cache;
+	u64 block_stamp{0};
 
 	std::array<u8, 0x10> dec_key{};
 
@@ -80,6 +90,7 @@ public:
 	// false if invalid 
 	bool ReadHeader();
 	u64 ReadData(u64 pos, u8* data, u64 size);
+	const std::vector<u8>* GetBlock(u32 index);
 
 	fs::stat_t stat() override
 	{
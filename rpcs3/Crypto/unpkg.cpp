@@ -4,10 +4,104 @@
 #include "sha1.h"
 #include "key_vault.h"
 #include "Utilities/StrFmt.h"
+#include "Utilities/Thread.h"
 #include "Emu/System.h"
 #include "Emu/VFS.h"
 #include "unpkg.h"
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+
+// Fixed set of threads executing queued tasks (created once per installation)
+class pkg_task_queue
+{
+	std::mutex m_mutex;
+	std::condition_variable m_cond; // Wakes up workers
+	std::condition_variable m_done; // Signals that all tasks are finished
+	std::deque<std::function<void()>> m_queue;
+	std::vector<std::shared_ptr<thread_ctrl>> m_workers;
+	u32 m_busy = 0;
+	bool m_exit = false;
+
+public:
+	pkg_task_queue(const std::string& name, u32 thread_count)
+	{
+		for (u32 i = 0; i < thread_count; i++)
+		{
+			m_workers.emplace_back();
+
+			thread_ctrl::spawn(m_workers.back(), fmt::format("%s %u", name, i), [this]()
+			{
+				while (true)
+				{
+					std::function<void()> task;
+					{
+						std::unique_lock<std::mutex> lock(m_mutex);
+
+						m_cond.wait(lock, [&] { return m_exit || !m_queue.empty(); });
+
+						if (m_exit)
+						{
+							return;
+						}
+
+						task = std::move(m_queue.front());
+						m_queue.pop_front();
+						m_busy++;
+					}
+
+					task();
+
+					{
+						std::lock_guard<std::mutex> lock(m_mutex);
+
+						if (!--m_busy && m_queue.empty())
+						{
+							m_done.notify_all();
+						}
+					}
+				}
+			});
+		}
+	}
+
+	~pkg_task_queue()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exit = true;
+		}
+
+		m_cond.notify_all();
+
+		for (auto& worker : m_workers)
+		{
+			worker->join();
+		}
+	}
+
+	void push(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_queue.emplace_back(std::move(task));
+		}
+
+		m_cond.notify_one();
+	}
+
+	// Wait for all queued tasks
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		m_done.wait(lock, [&] { return !m_busy && m_queue.empty(); });
+	}
+};
+
 bool pkg_install(const std::string& path, atomic_t<double>& sync)
 {
 	const std::size_t BUF_SIZE = 8192 * 1024; // 8 MB
@@ -216,20 +310,13 @@ bool pkg_install(const std::string& path, atomic_t<double>& sync)
 		}
 	}
 
-	// Allocate buffer with BUF_SIZE size or more if required
+	// Allocate buffers with BUF_SIZE size or more if required (the second one is used for pipelining)
 	const std::unique_ptr<u128[]> buf(new u128[std::max<u64>(BUF_SIZE, sizeof(PKGEntry) * header.file_count) / sizeof(u128)]);
+	const std::unique_ptr<u128[]> buf2(new u128[BUF_SIZE / sizeof(u128)]);
 
-	// Define decryption subfunction (`psp` arg selects the key for specific block)
-	auto decrypt = [&](u64 offset, u64 size, const uchar* key) -> u64
+	// Decrypt `blocks` 16-byte blocks of the stream at `offset`
+	auto decrypt_blocks = [&](u128* data, u64 offset, u64 blocks, const uchar* key)
 	{
-		archive_seek(header.data_offset + offset);
-
-		// Read the data and set available size
-		const u64 read = archive_read(buf.get(), size);
-
-		// Get block count
-		const u64 blocks = (read + 15) / 16;
-
 		if (header.pkg_type == PKG_RELEASE_TYPE_DEBUG)
 		{
 			// Debug key
@@ -254,7 +341,7 @@ bool pkg_install(const std::string& path, atomic_t<double>& sync)
 				
 				sha1(reinterpret_cast<const u8*>(input), sizeof(input), hash.data);
 
-				buf[i] ^= hash._v128;
+				data[i] ^= hash._v128;
 			}
 		}
 
@@ -275,14 +362,57 @@ bool pkg_install(const std::string& path, atomic_t<double>& sync)
 
 				aes_crypt_ecb(&ctx, AES_ENCRYPT, reinterpret_cast<const u8*>(&input), reinterpret_cast<u8*>(&key));
 
-				buf[i] ^= key;
+				data[i] ^= key;
 			}
 		}
+	};
+
+	const u32 thread_count = std::max<u32>(std::thread::hardware_concurrency(), 1);
+
+	// Decryption helpers (the calling thread also takes a part of the work)
+	pkg_task_queue decrypt_queue("PKG Decrypt", thread_count - 1);
+
+	// Define decryption subfunction (`psp` arg selects the key for specific block)
+	auto decrypt = [&](u64 offset, u64 size, const uchar* key, u128* data) -> u64
+	{
+		archive_seek(header.data_offset + offset);
+
+		// Read the data and set available size
+		const u64 read = archive_read(data, size);
+
+		// Get block count
+		const u64 blocks = (read + 15) / 16;
+
+		// Every block is independent, so split large reads between threads (at least 256 KiB each)
+		const u64 workers = std::min<u64>(thread_count, blocks / 0x4000);
+
+		if (workers <= 1)
+		{
+			decrypt_blocks(data, offset, blocks, key);
+			return read;
+		}
+
+		const u64 step = (blocks + workers - 1) / workers;
 
-		// Return the amount of data written in buf
+		for (u64 start = step; start < blocks; start += step)
+		{
+			decrypt_queue.push([=, &decrypt_blocks]()
+			{
+				decrypt_blocks(data + start, offset + start * 16, std::min(step, blocks - start), key);
+			});
+		}
+
+		decrypt_blocks(data, offset, step, key);
+
+		decrypt_queue.wait();
+
+		// Return the amount of data written in data
 		return read;
 	};
 
+	// The previous block of a file is written while the next one is read and decrypted
+	pkg_task_queue write_queue("PKG Writer", 1);
+
 	std::array<uchar, 16> dec_key;
 
 	if (header.pkg_platform == PKG_PLATFORM_TYPE_PSP && content_type >= 0x15 && content_type <= 0x17)
@@ -294,12 +424,12 @@ bool pkg_install(const std::string& path, atomic_t<double>& sync)
 		aes_context ctx;
 		aes_setkey_enc(&ctx, content_type == 0x15 ? psp2t1 : content_type == 0x16 ? psp2t2 : psp2t3, 128);
 		aes_crypt_ecb(&ctx, AES_ENCRYPT, reinterpret_cast<const uchar*>(&header.klicensee), dec_key.data());
-		decrypt(0, header.file_count * sizeof(PKGEntry), dec_key.data());
+		decrypt(0, header.file_count * sizeof(PKGEntry), dec_key.data(), buf.get());
 	}
 	else
 	{
 		std::memcpy(dec_key.data(), PKG_AES_KEY, dec_key.size());
-		decrypt(0, header.file_count * sizeof(PKGEntry), header.pkg_platform == PKG_PLATFORM_TYPE_PSP ? PKG_AES_KEY2 : dec_key.data());
+		decrypt(0, header.file_count * sizeof(PKGEntry), header.pkg_platform == PKG_PLATFORM_TYPE_PSP ? PKG_AES_KEY2 : dec_key.data(), buf.get());
 	}
 
 	std::vector<PKGEntry> entries(header.file_count);
@@ -316,7 +446,7 @@ bool pkg_install(const std::string& path, atomic_t<double>& sync)
 			continue;
 		}
 
-		decrypt(entry.name_offset, entry.name_size, is_psp ? PKG_AES_KEY2 : dec_key.data());
+		decrypt(entry.name_offset, entry.name_size, is_psp ? PKG_AES_KEY2 : dec_key.data(), buf.get());
 
 		std::string name{reinterpret_cast<char*>(buf.get()), entry.name_size};
 
@@ -348,27 +478,44 @@ bool pkg_install(const std::string& path, atomic_t<double>& sync)
 
 			if (fs::file out{path, fs::rewrite})
 			{
-				for (u64 pos = 0; pos < entry.file_size; pos += BUF_SIZE)
+				// Preallocate the output file
+				out.trunc(entry.file_size);
+
+				atomic_t<bool> write_failed{false};
+
+				for (u64 pos = 0, index = 0; pos < entry.file_size; pos += BUF_SIZE, index ^= 1)
 				{
 					const u64 block_size = std::min<u64>(BUF_SIZE, entry.file_size - pos);
 
-					if (decrypt(entry.file_offset + pos, block_size, is_psp ? PKG_AES_KEY2 : dec_key.data()) != block_size)
+					u128* const data = index ? buf2.get() : buf.get();
+
+					if (decrypt(entry.file_offset + pos, block_size, is_psp ? PKG_AES_KEY2 : dec_key.data(), data) != block_size)
 					{
 						LOG_ERROR(LOADER, "Failed to extract file %s", path);
 						break;
 					}
 
-					if (out.write(buf.get(), block_size) != block_size)
+					write_queue.wait();
+
+					if (write_failed)
 					{
-						LOG_ERROR(LOADER, "Failed to write file %s", path);
 						break;
 					}
 
+					write_queue.push([&out, &write_failed, data, block_size]()
+					{
+						if (out.write(data, block_size) != block_size)
+						{
+							write_failed = true;
+						}
+					});
+
 					if (sync.fetch_add((block_size + 0.0) / header.data_size) < 0.)
 					{
 						if (was_null)
 						{
 							LOG_ERROR(LOADER, "Package installation cancelled: %s", dir);
+							write_queue.wait();
 							out.close();
 							fs::remove_all(dir, true);
 							return false;
@@ -379,6 +526,13 @@ bool pkg_install(const std::string& path, atomic_t<double>& sync)
 					}
 				}
 
+				write_queue.wait();
+
+				if (write_failed)
+				{
+					LOG_ERROR(LOADER, "Failed to write file %s", path);
+				}
+
 				if (did_overwrite)
 				{
 					LOG_WARNING(LOADER, "Overwritten file %s", name);
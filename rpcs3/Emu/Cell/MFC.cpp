@@ -200,6 +200,8 @@ void mfc_thread::cpu_task()
 						{
 							cmd.lsa &= 0x3fff0;
 
+							spu_dma_list_batch batch(spu, cmd);
+
 							// try to get the whole list done in one go
 							while (cmd.size != 0)
 							{
@@ -218,7 +220,7 @@ void mfc_thread::cpu_task()
 									transfer.cmd = MFC(cmd.cmd & ~MFC_LIST_MASK);
 									transfer.size = size;
 
-									spu.do_dma_transfer(transfer);
+									batch.push(transfer);
 									cmd.lsa += std::max<u32>(size, 16);
 								}
 
@@ -229,6 +231,8 @@ void mfc_thread::cpu_task()
 								// dont stall for last 'item' in list
 								if ((item.sb & 0x8000) && (cmd.size != 0))
 								{
+									batch.flush();
+
 									spu.ch_stall_mask |= (1 << cmd.tag);
 									spu.ch_stall_stat.push_or(spu, 1 << cmd.tag);
 
@@ -241,6 +245,8 @@ void mfc_thread::cpu_task()
 									break;
 								}
 							}
+
+							batch.flush();
 						}
 
 						if (cmd.size != 0 && (cmd.cmd & MFC_BARRIER_MASK))
@@ -280,6 +286,12 @@ void mfc_thread::cpu_task()
 						break;
 					}
 				}
+
+				// Wake up the SPU waiting for a free queue entry
+				if (spu.mfc_queue.size() < queue_size && spu.mfc_queue_wait.exchange(false))
+				{
+					spu.notify();
+				}
 			}
 
 			test_state();
@@ -7,6 +7,7 @@
 #include "Emu/Audio/AudioDumper.h"
 #include "Emu/Audio/AudioThread.h"
 #include "cellAudio.h"
+#include "cellAudioMix.h"
 
 #include <thread>
 
@@ -61,8 +62,9 @@ void audio_config::on_task()
 
 	AudioDumper m_dump(g_cfg.audio.dump_to_file ? 2 : 0); // Init AudioDumper for 2 channels if enabled
 
-	float buf2ch[2 * BUFFER_SIZE]{}; // intermediate buffer for 2 channels
-	float buf8ch[8 * BUFFER_SIZE]{}; // intermediate buffer for 8 channels
+	alignas(16) float buf2ch[2 * BUFFER_SIZE]{}; // intermediate buffer for 2 channels
+	alignas(16) float buf8ch[8 * BUFFER_SIZE]{}; // intermediate buffer for 8 channels
+	alignas(16) float levels[BUFFER_SIZE]; // port level for every frame
 
 	const u32 buf_sz = BUFFER_SIZE * (g_cfg.audio.convert_to_u16 ? 2 : 4) * (g_cfg.audio.downmix_to_2ch ? 2 : 8);
 
@@ -94,7 +96,8 @@ void audio_config::on_task()
 		const u64 expected_time = m_counter * AUDIO_SAMPLES * 1000000 / 48000;
 		if (expected_time >= time_pos)
 		{
-			std::this_thread::sleep_for(1ms); // hack
+			// Sleep until the next period is due
+			thread_ctrl::wait_for(expected_time - time_pos + 1);
 			continue;
 		}
 
@@ -115,9 +118,6 @@ void audio_config::on_task()
 
 			auto buf = vm::_ptr<f32>(buf_addr);
 
-			static const float k = 1.0f; // may be 1.0f
-			const float& m = port.level;
-
 			auto step_volume = [](audio_port& port) // part of cellAudioSetPortLevel functionality
 			{
 				const auto param = port.level_set.load();
@@ -135,116 +135,27 @@ void audio_config::on_task()
 				}
 			};
 
-			if (port.channel == 2)
+			for (u32 i = 0; i < BUFFER_SIZE; i++)
 			{
-				if (first_mix)
-				{
-					for (u32 i = 0; i < (sizeof(buf2ch) / sizeof(float)); i += 2)
-					{
-						step_volume(port);
-
-						// reverse byte order
-						const float left = buf[i + 0] * m;
-						const float right = buf[i + 1] * m;
-
-						buf2ch[i + 0] = left;
-						buf2ch[i + 1] = right;
-
-						buf8ch[i * 4 + 0] = left;
-						buf8ch[i * 4 + 1] = right;
-						buf8ch[i * 4 + 2] = 0.0f;
-						buf8ch[i * 4 + 3] = 0.0f;
-						buf8ch[i * 4 + 4] = 0.0f;
-						buf8ch[i * 4 + 5] = 0.0f;
-						buf8ch[i * 4 + 6] = 0.0f;
-						buf8ch[i * 4 + 7] = 0.0f;
-					}
-					first_mix = false;
-				}
-				else
-				{
-					for (u32 i = 0; i < (sizeof(buf2ch) / sizeof(float)); i += 2)
-					{
-						step_volume(port);
-
-						const float left = buf[i + 0] * m;
-						const float right = buf[i + 1] * m;
-
-						buf2ch[i + 0] += left;
-						buf2ch[i + 1] += right;
+				step_volume(port);
+				levels[i] = port.level;
+			}
 
-						buf8ch[i * 4 + 0] += left;
-						buf8ch[i * 4 + 1] += right;
-					}
-				}
+			if (port.channel == 2)
+			{
+				first_mix ? audio_mix_2ch<false>(buf2ch, buf8ch, buf, levels) : audio_mix_2ch<true>(buf2ch, buf8ch, buf, levels);
 			}
 			else if (port.channel == 8)
 			{
-				if (first_mix)
-				{
-					for (u32 i = 0; i < (sizeof(buf2ch) / sizeof(float)); i += 2)
-					{
-						step_volume(port);
-
-						const float left = buf[i * 4 + 0] * m;
-						const float right = buf[i * 4 + 1] * m;
-						const float center = buf[i * 4 + 2] * m;
-						const float low_freq = buf[i * 4 + 3] * m;
-						const float rear_left = buf[i * 4 + 4] * m;
-						const float rear_right = buf[i * 4 + 5] * m;
-						const float side_left = buf[i * 4 + 6] * m;
-						const float side_right = buf[i * 4 + 7] * m;
-
-						const float mid = (center + low_freq) * 0.708f;
-						buf2ch[i + 0] = (left + rear_left + side_left + mid) * k;
-						buf2ch[i + 1] = (right + rear_right + side_right + mid) * k;
-
-						buf8ch[i * 4 + 0] = left;
-						buf8ch[i * 4 + 1] = right;
-						buf8ch[i * 4 + 2] = center;
-						buf8ch[i * 4 + 3] = low_freq;
-						buf8ch[i * 4 + 4] = rear_left;
-						buf8ch[i * 4 + 5] = rear_right;
-						buf8ch[i * 4 + 6] = side_left;
-						buf8ch[i * 4 + 7] = side_right;
-					}
-					first_mix = false;
-				}
-				else
-				{
-					for (u32 i = 0; i < (sizeof(buf2ch) / sizeof(float)); i += 2)
-					{
-						step_volume(port);
-
-						const float left = buf[i * 4 + 0] * m;
-						const float right = buf[i * 4 + 1] * m;
-						const float center = buf[i * 4 + 2] * m;
-						const float low_freq = buf[i * 4 + 3] * m;
-						const float rear_left = buf[i * 4 + 4] * m;
-						const float rear_right = buf[i * 4 + 5] * m;
-						const float side_left = buf[i * 4 + 6] * m;
-						const float side_right = buf[i * 4 + 7] * m;
-
-						const float mid = (center + low_freq) * 0.708f;
-						buf2ch[i + 0] += (left + rear_left + side_left + mid) * k;
-						buf2ch[i + 1] += (right + rear_right + side_right + mid) * k;
-
-						buf8ch[i * 4 + 0] += left;
-						buf8ch[i * 4 + 1] += right;
-						buf8ch[i * 4 + 2] += center;
-						buf8ch[i * 4 + 3] += low_freq;
-						buf8ch[i * 4 + 4] += rear_left;
-						buf8ch[i * 4 + 5] += rear_right;
-						buf8ch[i * 4 + 6] += side_left;
-						buf8ch[i * 4 + 7] += side_right;
-					}
-				}
+				first_mix ? audio_mix_8ch<false>(buf2ch, buf8ch, buf, levels) : audio_mix_8ch<true>(buf2ch, buf8ch, buf, levels);
 			}
 			else
 			{
 				fmt::throw_exception("Unknown channel count (port=%u, channel=%d)" HERE, port.number, port.channel);
 			}
 
+			first_mix = false;
+
 			memset(buf, 0, block_size * sizeof(float));
 		}
 
@@ -254,17 +165,11 @@ void audio_config::on_task()
 			// Copy output data (2ch or 8ch)
 			if (g_cfg.audio.downmix_to_2ch)
 			{
-				for (u32 i = 0; i < (sizeof(buf2ch) / sizeof(float)); i++)
-				{
-					out_buffer[out_pos][i] = buf2ch[i];
-				}
+				std::memcpy(out_buffer[out_pos].get(), buf2ch, sizeof(buf2ch));
 			}
 			else
 			{
-				for (u32 i = 0; i < (sizeof(buf8ch) / sizeof(float)); i++)
-				{
-					out_buffer[out_pos][i] = buf8ch[i];
-				}
+				std::memcpy(out_buffer[out_pos].get(), buf8ch, sizeof(buf8ch));
 			}
 		}
 
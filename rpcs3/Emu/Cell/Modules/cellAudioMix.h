@@ -0,0 +1,106 @@
+#pragma once
+
+#include "cellAudio.h"
+
+// SSE mixers used by cellAudio (the results are bit-identical to the scalar per-sample code)
+
+// Load 4 big-endian floats
+inline __m128 audio_load_be(const be_t<f32>* src)
+{
+	const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+	const __m128i y = _mm_or_si128(_mm_slli_epi32(x, 16), _mm_srli_epi32(x, 16));
+	return _mm_castsi128_ps(_mm_or_si128(_mm_slli_epi16(y, 8), _mm_srli_epi16(y, 8)));
+}
+
+// Mix 2-channel port data (with per-frame levels) into the intermediate buffers
+template <bool Accumulate>
+void audio_mix_2ch(float* buf2ch, float* buf8ch, const be_t<f32>* src, const float* levels)
+{
+	const __m128 zero = _mm_setzero_ps();
+
+	for (u32 f = 0; f < BUFFER_SIZE; f += 4)
+	{
+		const __m128 lv = _mm_load_ps(levels + f);
+
+		// 2 frames per vector
+		const __m128 x0 = _mm_mul_ps(audio_load_be(src + f * 2 + 0), _mm_unpacklo_ps(lv, lv));
+		const __m128 x1 = _mm_mul_ps(audio_load_be(src + f * 2 + 4), _mm_unpackhi_ps(lv, lv));
+
+		float* const out2 = buf2ch + f * 2;
+		float* const out8 = buf8ch + f * 8;
+
+		if (Accumulate)
+		{
+			_mm_store_ps(out2 + 0, _mm_add_ps(_mm_load_ps(out2 + 0), x0));
+			_mm_store_ps(out2 + 4, _mm_add_ps(_mm_load_ps(out2 + 4), x1));
+
+			// Only front channels are affected
+			_mm_storel_pi(reinterpret_cast<__m64*>(out8 + 0), _mm_add_ps(_mm_loadl_pi(zero, reinterpret_cast<const __m64*>(out8 + 0)), x0));
+			_mm_storel_pi(reinterpret_cast<__m64*>(out8 + 8), _mm_add_ps(_mm_loadl_pi(zero, reinterpret_cast<const __m64*>(out8 + 8)), _mm_movehl_ps(x0, x0)));
+			_mm_storel_pi(reinterpret_cast<__m64*>(out8 + 16), _mm_add_ps(_mm_loadl_pi(zero, reinterpret_cast<const __m64*>(out8 + 16)), x1));
+			_mm_storel_pi(reinterpret_cast<__m64*>(out8 + 24), _mm_add_ps(_mm_loadl_pi(zero, reinterpret_cast<const __m64*>(out8 + 24)), _mm_movehl_ps(x1, x1)));
+		}
+		else
+		{
+			_mm_store_ps(out2 + 0, x0);
+			_mm_store_ps(out2 + 4, x1);
+
+			_mm_store_ps(out8 + 0, _mm_movelh_ps(x0, zero));
+			_mm_store_ps(out8 + 4, zero);
+			_mm_store_ps(out8 + 8, _mm_movehl_ps(zero, x0));
+			_mm_store_ps(out8 + 12, zero);
+			_mm_store_ps(out8 + 16, _mm_movelh_ps(x1, zero));
+			_mm_store_ps(out8 + 20, zero);
+			_mm_store_ps(out8 + 24, _mm_movehl_ps(zero, x1));
+			_mm_store_ps(out8 + 28, zero);
+		}
+	}
+}
+
+// Mix 8-channel port data (with per-frame levels) into the intermediate buffers, downmixing it for 2 channels
+template <bool Accumulate>
+void audio_mix_8ch(float* buf2ch, float* buf8ch, const be_t<f32>* src, const float* levels)
+{
+	const __m128 mid_scale = _mm_set1_ps(0.708f);
+
+	for (u32 f = 0; f < BUFFER_SIZE; f += 2)
+	{
+		const __m128 m0 = _mm_set1_ps(levels[f + 0]);
+		const __m128 m1 = _mm_set1_ps(levels[f + 1]);
+
+		// L, R, C, LFE and RL, RR, SL, SR for 2 frames
+		const __m128 a0 = _mm_mul_ps(audio_load_be(src + f * 8 + 0), m0);
+		const __m128 b0 = _mm_mul_ps(audio_load_be(src + f * 8 + 4), m0);
+		const __m128 a1 = _mm_mul_ps(audio_load_be(src + f * 8 + 8), m1);
+		const __m128 b1 = _mm_mul_ps(audio_load_be(src + f * 8 + 12), m1);
+
+		const __m128 front = _mm_movelh_ps(a0, a1);
+		const __m128 center = _mm_movehl_ps(a1, a0);
+		const __m128 rear = _mm_movelh_ps(b0, b1);
+		const __m128 side = _mm_movehl_ps(b1, b0);
+
+		// (center + low_freq) * 0.708f for both output channels
+		const __m128 mid = _mm_mul_ps(_mm_add_ps(_mm_shuffle_ps(center, center, 0xa0), _mm_shuffle_ps(center, center, 0xf5)), mid_scale);
+		const __m128 down = _mm_add_ps(_mm_add_ps(_mm_add_ps(front, rear), side), mid);
+
+		float* const out2 = buf2ch + f * 2;
+		float* const out8 = buf8ch + f * 8;
+
+		if (Accumulate)
+		{
+			_mm_store_ps(out2, _mm_add_ps(_mm_load_ps(out2), down));
+			_mm_store_ps(out8 + 0, _mm_add_ps(_mm_load_ps(out8 + 0), a0));
+			_mm_store_ps(out8 + 4, _mm_add_ps(_mm_load_ps(out8 + 4), b0));
+			_mm_store_ps(out8 + 8, _mm_add_ps(_mm_load_ps(out8 + 8), a1));
+			_mm_store_ps(out8 + 12, _mm_add_ps(_mm_load_ps(out8 + 12), b1));
+		}
+		else
+		{
+			_mm_store_ps(out2, down);
+			_mm_store_ps(out8 + 0, a0);
+			_mm_store_ps(out8 + 4, b0);
+			_mm_store_ps(out8 + 8, a1);
+			_mm_store_ps(out8 + 12, b1);
+		}
+	}
+}
@@ -111,6 +111,21 @@ void fmt_class_string<ppu_decoder_type>::format(std::string& out, u64 arg)
 	});
 }
 
+template <>
+void fmt_class_string<ppu_llvm_opt_type>::format(std::string& out, u64 arg)
+{
+	format_enum(out, arg, [](ppu_llvm_opt_type type)
+	{
+		switch (type)
+		{
+		case ppu_llvm_opt_type::fast: return "Fast";
+		case ppu_llvm_opt_type::throughput: return "Throughput";
+		}
+
+		return unknown;
+	});
+}
+
 // Table of identical interpreter functions when precise contains SSE2 version, and fast contains SSSE3 functions
 const std::pair<ppu_inter_func_t, ppu_inter_func_t> s_ppu_dispatch_table[]
 {
@@ -164,6 +179,7 @@ extern const ppu_decoder<ppu_interpreter_fast> g_ppu_interpreter_fast([](auto& t
 });
 
 extern void ppu_initialize();
+extern void spu_initialize();
 extern void ppu_initialize(const ppu_module& info);
 static void ppu_initialize2(class jit_compiler& jit, const ppu_module& module_part, const std::string& cache_path, const std::string& obj_name, u32 fragment_index, atomic_t<u32>&);
 extern void ppu_execute_syscall(ppu_thread& ppu, u64 code);
@@ -920,6 +936,7 @@ static void ppu_trace(u64 addr)
 
 extern u32 ppu_lwarx(ppu_thread& ppu, u32 addr)
 {
+	vm::reservation_stat(addr, ppu.id, vm::reservation_event::acquire);
 	ppu.rtime = vm::reservation_acquire(addr, sizeof(u32));
 	_mm_lfence();
 	ppu.raddr = addr;
@@ -929,6 +946,7 @@ extern u32 ppu_lwarx(ppu_thread& ppu, u32 addr)
 
 extern u64 ppu_ldarx(ppu_thread& ppu, u32 addr)
 {
+	vm::reservation_stat(addr, ppu.id, vm::reservation_event::acquire);
 	ppu.rtime = vm::reservation_acquire(addr, sizeof(u64));
 	_mm_lfence();
 	ppu.raddr = addr;
@@ -942,6 +960,7 @@ extern bool ppu_stwcx(ppu_thread& ppu, u32 addr, u32 reg_value)
 
 	if (ppu.raddr != addr || ppu.rdata != data.load())
 	{
+		vm::reservation_stat(addr, ppu.id, vm::reservation_event::failure);
 		ppu.raddr = 0;
 		return false;
 	}
@@ -962,6 +981,7 @@ extern bool ppu_stwcx(ppu_thread& ppu, u32 addr, u32 reg_value)
 		}
 
 		_xend();
+		vm::reservation_stat(addr, ppu.id, result ? vm::reservation_event::success : vm::reservation_event::failure);
 		ppu.raddr = 0;
 		return result;
 	}
@@ -976,6 +996,7 @@ extern bool ppu_stwcx(ppu_thread& ppu, u32 addr, u32 reg_value)
 		vm::notify(addr, sizeof(u32));
 	}
 
+	vm::reservation_stat(addr, ppu.id, result ? vm::reservation_event::success : vm::reservation_event::failure);
 	ppu.raddr = 0;
 	return result;
 }
@@ -986,6 +1007,7 @@ extern bool ppu_stdcx(ppu_thread& ppu, u32 addr, u64 reg_value)
 
 	if (ppu.raddr != addr || ppu.rdata != data.load())
 	{
+		vm::reservation_stat(addr, ppu.id, vm::reservation_event::failure);
 		ppu.raddr = 0;
 		return false;
 	}
@@ -1006,6 +1028,7 @@ extern bool ppu_stdcx(ppu_thread& ppu, u32 addr, u64 reg_value)
 		}
 
 		_xend();
+		vm::reservation_stat(addr, ppu.id, result ? vm::reservation_event::success : vm::reservation_event::failure);
 		ppu.raddr = 0;
 		return result;
 	}
@@ -1020,6 +1043,7 @@ extern bool ppu_stdcx(ppu_thread& ppu, u32 addr, u64 reg_value)
 		vm::notify(addr, sizeof(u64));
 	}
 
+	vm::reservation_stat(addr, ppu.id, result ? vm::reservation_event::success : vm::reservation_event::failure);
 	ppu.raddr = 0;
 	return result;
 }
@@ -1059,7 +1083,28 @@ extern void ppu_initialize()
 	{
 		ppu_initialize(*ptr);
 	}
+
+	// Initialize SPU function cache
+	spu_initialize();
+}
+
+#ifdef LLVM_AVAILABLE
+// Hash code with relocated immediate fields cleared (translated code loads them from memory)
+static void ppu_hash_code(sha1_context& ctx, const std::vector<u32>& reloc_ops, u32 addr, u32 size)
+{
+	const u32 end = addr + size;
+
+	for (auto it = std::lower_bound(reloc_ops.cbegin(), reloc_ops.cend(), addr); it != reloc_ops.cend() && *it < end; it++)
+	{
+		const be_t<u32> op = vm::read32(*it) & 0xffff0000;
+		sha1_update(&ctx, vm::_ptr<const u8>(addr), *it - addr);
+		sha1_update(&ctx, reinterpret_cast<const u8*>(&op), sizeof(op));
+		addr = *it + 4;
+	}
+
+	sha1_update(&ctx, vm::_ptr<const u8>(addr), end - addr);
 }
+#endif
 
 extern void ppu_initialize(const ppu_module& info)
 {
@@ -1165,16 +1210,19 @@ extern void ppu_initialize(const ppu_module& info)
 	// Compiler mutex (global)
 	static semaphore<> jmutex;
 
-	// Initialize semaphore with the max number of threads
-	u32 max_threads = static_cast<u32>(g_cfg.core.llvm_threads);
-	s32 thread_count = max_threads > 0 ? std::min(max_threads, std::thread::hardware_concurrency()) : std::thread::hardware_concurrency();
-	semaphore<INT32_MAX> jcores(thread_count);
+	// Get the max number of threads
+	const u32 max_threads = static_cast<u32>(g_cfg.core.llvm_threads);
+	const u32 thread_count = std::max<u32>(max_threads > 0 ? std::min(max_threads, std::thread::hardware_concurrency()) : std::thread::hardware_concurrency(), 1);
 
-	if (!jcores.get())
+	// Module fragment to compile
+	struct jit_work
 	{
-		// Min value 1
-		jcores.post();
-	}
+		std::string obj_name;
+		ppu_module part;
+		std::size_t cost; // Estimated compilation cost (code size)
+	};
+
+	std::vector<jit_work> workload;
 
 	// Worker threads
 	std::vector<std::thread> jthreads;
@@ -1182,7 +1230,7 @@ extern void ppu_initialize(const ppu_module& info)
 	// Global variables to initialize
 	std::vector<std::pair<std::string, u64>> globals;
 
-	// Split module into fragments <= 1 MiB
+	// Split module into fragments (at most 256 KiB of address space each)
 	std::size_t fpos = 0;
 
 	// Difference between function name and current location
@@ -1192,6 +1240,19 @@ extern void ppu_initialize(const ppu_module& info)
 
 	u32 fragment_count{0};
 
+	// Addresses of instructions with relocated 16-bit immediate (sorted)
+	std::vector<u32> reloc_ops;
+
+	for (const auto& rel : info.relocs)
+	{
+		if (rel.type == 4 || rel.type == 5 || rel.type == 6)
+		{
+			reloc_ops.emplace_back(rel.addr & ~3);
+		}
+	}
+
+	std::sort(reloc_ops.begin(), reloc_ops.end());
+
 	while (jit_mod.vars.empty() && fpos < info.funcs.size())
 	{
 		// Initialize compiler instance
@@ -1218,7 +1279,8 @@ extern void ppu_initialize(const ppu_module& info)
 		{
 			auto& func = info.funcs[fpos];
 
-			if (bsize + func.size > 256 * 1024 && bsize)
+			// Use fixed address boundaries, so a local change doesn't shift other fragments and invalidate their objects
+			if (fpos > fstart && (func.addr - reloc) / 0x40000 != (info.funcs[fstart].addr - reloc) / 0x40000)
 			{
 				break;
 			}
@@ -1271,29 +1333,25 @@ extern void ppu_initialize(const ppu_module& info)
 				sha1_update(&ctx, reinterpret_cast<const u8*>(&addr), sizeof(addr));
 				sha1_update(&ctx, reinterpret_cast<const u8*>(&size), sizeof(size));
 
+				// Code is hashed independently of the load address, so identical modules share objects
 				for (const auto& block : func.blocks)
 				{
-					if (block.second == 0 || reloc)
+					if (block.second == 0)
 					{
 						continue;
 					}
 
-					// TODO: relocations must be taken into account (TODO)
-					sha1_update(&ctx, vm::_ptr<const u8>(block.first), block.second);
+					ppu_hash_code(ctx, reloc_ops, block.first, block.second);
 				}
 
-				if (reloc)
-				{
-					continue;
-				}
-
-				sha1_update(&ctx, vm::_ptr<const u8>(func.addr), func.size);
+				ppu_hash_code(ctx, reloc_ops, func.addr, func.size);
 			}
 
-			if (info.name == "liblv2.sprx" || info.name == "libsysmodule.sprx" || info.name == "libnet.sprx")
+			// Objects built with different optimization levels must not be mixed
+			if (g_cfg.core.llvm_opt != ppu_llvm_opt_type::fast)
 			{
-				const be_t<u64> forced_upd = 3;
-				sha1_update(&ctx, reinterpret_cast<const u8*>(&forced_upd), sizeof(forced_upd));
+				const be_t<u32> opt = static_cast<u32>(g_cfg.core.llvm_opt.get());
+				sha1_update(&ctx, reinterpret_cast<const u8*>(&opt), sizeof(opt));
 			}
 
 			sha1_finish(&ctx, output);
@@ -1324,40 +1382,56 @@ extern void ppu_initialize(const ppu_module& info)
 			continue;
 		}
 
+		workload.push_back({std::move(obj_name), std::move(part), bsize});
+	}
+
+	// Compile the most expensive fragments first, so that the work is balanced at the end
+	std::stable_sort(workload.begin(), workload.end(), [](const jit_work& a, const jit_work& b)
+	{
+		return a.cost > b.cost;
+	});
+
+	// Initialize fragment count sync var
+	fragment_sync.exchange(::size32(workload));
+
+	// Next fragment to compile (shared by all workers)
+	atomic_t<u32> work_index{0};
+
+	for (u32 i = 0; i < std::min<u32>(thread_count, ::size32(workload)); i++)
+	{
 		// Create worker thread for compilation
-		jthreads.emplace_back([&jit, &jcores, obj_name = obj_name, part = std::move(part), &cache_path, &fragment_sync, findex = ::size32(jthreads)]()
+		jthreads.emplace_back([&]()
 		{
 			// Set low priority
 			thread_ctrl::set_native_priority(-1);
 
-			// Allocate "core"
+			for (u32 findex; (findex = work_index++) < workload.size();)
 			{
-				semaphore_lock jlock(jcores);
-
 				if (Emu.IsStopped())
 				{
 					return;
 				}
 
-				// Use another JIT instance
-				jit_compiler jit2({}, g_cfg.core.llvm_cpu);
-				ppu_initialize2(jit2, part, cache_path, obj_name, findex, fragment_sync);
-			}
+				const auto& work = workload[findex];
 
-			if (Emu.IsStopped() || !fs::is_file(cache_path + obj_name))
-			{
-				return;
-			}
+				{
+					// Use another JIT instance
+					jit_compiler jit2({}, g_cfg.core.llvm_cpu);
+					ppu_initialize2(jit2, work.part, cache_path, work.obj_name, findex, fragment_sync);
+				}
 
-			// Proceed with original JIT instance
-			semaphore_lock lock(jmutex);
-			jit->add(cache_path + obj_name);
+				if (Emu.IsStopped() || !fs::is_file(cache_path + work.obj_name))
+				{
+					continue;
+				}
+
+				// Proceed with original JIT instance
+				semaphore_lock lock(jmutex);
+				jit->add(cache_path + work.obj_name);
+			}
 		});
 	}
 
-	// Initialize fragment count sync var
-	fragment_sync.exchange(::size32(jthreads));
-
 	// Join worker threads
 	for (auto& thread : jthreads)
 	{
@@ -1471,28 +1545,48 @@ static void ppu_initialize2(jit_compiler& jit, const ppu_module& module_part, co
 
 	std::shared_ptr<MsgDialogBase> dlg;
 
+	const u64 start_time = get_system_time();
+
+	const ppu_llvm_opt_type opt = g_cfg.core.llvm_opt;
+
 	{
 		legacy::FunctionPassManager pm(module.get());
 
-		// Basic optimizations
-		//pm.add(createCFGSimplificationPass());
-		//pm.add(createPromoteMemoryToRegisterPass());
-		pm.add(createEarlyCSEPass());
-		//pm.add(createTailCallEliminationPass());
-		//pm.add(createInstructionCombiningPass());
-		//pm.add(createBasicAAWrapperPass());
-		//pm.add(new MemoryDependenceAnalysis());
-		//pm.add(createLICMPass());
-		//pm.add(createLoopInstSimplifyPass());
-		//pm.add(createNewGVNPass());
-		pm.add(createDeadStoreEliminationPass());
-		//pm.add(createSCCPPass());
-		//pm.add(createReassociatePass());
-		//pm.add(createInstructionCombiningPass());
-		//pm.add(createInstructionSimplifierPass());
-		//pm.add(createAggressiveDCEPass());
-		//pm.add(createCFGSimplificationPass());
-		//pm.add(createLintPass()); // Check
+		if (opt == ppu_llvm_opt_type::throughput)
+		{
+			// Full scalar optimizations
+			pm.add(createCFGSimplificationPass());
+			pm.add(createPromoteMemoryToRegisterPass());
+			pm.add(createEarlyCSEPass());
+			pm.add(createInstructionCombiningPass());
+			pm.add(createLICMPass());
+			pm.add(createNewGVNPass());
+			pm.add(createDeadStoreEliminationPass());
+			pm.add(createInstructionCombiningPass());
+			pm.add(createCFGSimplificationPass());
+		}
+		else
+		{
+			// Basic optimizations
+			//pm.add(createCFGSimplificationPass());
+			//pm.add(createPromoteMemoryToRegisterPass());
+			pm.add(createEarlyCSEPass());
+			//pm.add(createTailCallEliminationPass());
+			//pm.add(createInstructionCombiningPass());
+			//pm.add(createBasicAAWrapperPass());
+			//pm.add(new MemoryDependenceAnalysis());
+			//pm.add(createLICMPass());
+			//pm.add(createLoopInstSimplifyPass());
+			//pm.add(createNewGVNPass());
+			pm.add(createDeadStoreEliminationPass());
+			//pm.add(createSCCPPass());
+			//pm.add(createReassociatePass());
+			//pm.add(createInstructionCombiningPass());
+			//pm.add(createInstructionSimplifierPass());
+			//pm.add(createAggressiveDCEPass());
+			//pm.add(createCFGSimplificationPass());
+			//pm.add(createLintPass()); // Check
+		}
 
 		// Initialize message dialog
 		dlg = Emu.GetCallbacks().get_msg_dialog();
@@ -1586,10 +1680,25 @@ static void ppu_initialize2(jit_compiler& jit, const ppu_module& module_part, co
 			return;
 		}
 
-		LOG_NOTICE(PPU, "LLVM: %zu functions generated", module->getFunctionList().size());
+		// Count IR instructions
+		std::size_t inst_count = 0;
+
+		for (const auto& func : *module)
+		{
+			for (const auto& block : func)
+			{
+				inst_count += block.size();
+			}
+		}
+
+		LOG_NOTICE(PPU, "LLVM: %zu functions generated (%zu instructions, %s, %fs)", module->getFunctionList().size(), inst_count, opt, (get_system_time() - start_time) / 1000000.);
 	}
 
+	const u64 codegen_time = get_system_time();
+
 	// Load or compile module
 	jit.add(std::move(module), cache_path);
+
+	LOG_NOTICE(PPU, "LLVM: Code generation for %s took %fs", obj_name, (get_system_time() - codegen_time) / 1000000.);
 #endif // LLVM_AVAILABLE
 }
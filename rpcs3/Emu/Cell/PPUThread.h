@@ -149,6 +149,11 @@ public:
 	cmd64 cmd_get(u32 index) { return cmd_queue[cmd_queue.peek() + index].load(); }
 
 	u64 start_time{0}; // Sleep start timepoint
+
+	// Scheduler run queue links (protected by the scheduler mutex)
+	ppu_thread* sched_prev{};
+	ppu_thread* sched_next{};
+	u32 sched_prio{~0u}; // Priority of the run queue list (-1 if not queued)
 	const char* last_function{}; // Last function name for diagnosis, optimized for speed.
 
 	const std::string m_name; // Thread name
@@ -108,6 +108,8 @@ bool RawSPUThread::write_reg(const u32 addr, const u32 value)
 	{
 		if (!status.test_and_set(SPU_STATUS_RUNNING))
 		{
+			// LS may have been modified directly while stopped
+			on_ls_write(0, 0x40000);
 			run();
 		}
 	};
@@ -40,7 +40,7 @@ void spu_recompiler::compile(spu_function_t& f)
 {
 	std::lock_guard<std::mutex> lock(m_mutex);
 
-	if (f.compiled)
+	if (f.compiled.load())
 	{
 		// return if function already compiled
 		return;
@@ -253,7 +253,7 @@ void spu_recompiler::compile(spu_function_t& f)
 	Func fn;
 	m_jit->add(&fn, codeHolder);
 
-	f.compiled = asmjit::Internal::ptr_cast<decltype(f.compiled)>(fn);
+	f.compiled.store(asmjit::Internal::ptr_cast<u32(*)(SPUThread*, be_t<u32>*)>(fn));
 
 	if (g_cfg.core.spu_debug)
 	{
@@ -332,6 +332,45 @@ void spu_recompiler::CheckInterruptStatus(spu_opcode_t op)
 	}
 }
 
+void spu_recompiler::CheckCodeWrite()
+{
+	// Notify if a 128-byte line containing compiled code is written (uses *addr)
+	auto gate = [](SPUThread* _spu, u32 _lsa) noexcept
+	{
+		_spu->on_ls_write(_lsa, 16);
+	};
+
+	asmjit::Label skip = c->newLabel();
+	asmjit::X86Gp line = c->newUInt32("line");
+	c->mov(line, *addr);
+	c->shr(line, 7);
+	c->bt(SPU_OFF_32(ls_code_lines), line);
+	c->jnc(skip);
+	c->unuse(line);
+
+	asmjit::CCFuncCall* call = c->call(asmjit::imm_ptr(asmjit::Internal::ptr_cast<void*, void(SPUThread*, u32)>(gate)), asmjit::FuncSignature2<void, SPUThread*, u32>(asmjit::CallConv::kIdHost));
+	call->setArg(0, *cpu);
+	call->setArg(1, *addr);
+	c->bind(skip);
+}
+
+void spu_recompiler::CheckCodeWrite(u32 lsa)
+{
+	auto gate = [](SPUThread* _spu, u32 _lsa) noexcept
+	{
+		_spu->on_ls_write(_lsa, 16);
+	};
+
+	asmjit::Label skip = c->newLabel();
+	c->bt(SPU_OFF_64(ls_code_lines, lsa / 8192), lsa / 128 % 64);
+	c->jnc(skip);
+
+	asmjit::CCFuncCall* call = c->call(asmjit::imm_ptr(asmjit::Internal::ptr_cast<void*, void(SPUThread*, u32)>(gate)), asmjit::FuncSignature2<void, SPUThread*, u32>(asmjit::CallConv::kIdHost));
+	call->setArg(0, *cpu);
+	call->setArg(1, asmjit::imm_u(lsa));
+	c->bind(skip);
+}
+
 void spu_recompiler::InterpreterCall(spu_opcode_t op)
 {
 	auto gate = [](SPUThread* _spu, u32 opcode, spu_inter_func_t _func) noexcept -> u32
@@ -379,6 +418,9 @@ void spu_recompiler::FunctionCall()
 	{
 		_spu->recursion_level++;
 
+		// Stop chaining functions in spu_recompiler_base::enter when the link is reached
+		const u32 prev_link = std::exchange(_spu->call_link, link);
+
 		try
 		{
 			// TODO: check correctness
@@ -420,11 +462,13 @@ void spu_recompiler::FunctionCall()
 
 				if (_spu->pc == link)
 				{
+					_spu->call_link = prev_link;
 					_spu->recursion_level--;
 					return 0; // Successfully returned
 				}
 			}
 
+			_spu->call_link = prev_link;
 			_spu->recursion_level--;
 			return 0x2000000 | _spu->pc;
 		}
@@ -432,6 +476,7 @@ void spu_recompiler::FunctionCall()
 		{
 			_spu->pending_exception = std::current_exception();
 
+			_spu->call_link = prev_link;
 			_spu->recursion_level--;
 			return 0x1000000 | _spu->pc;
 		}
@@ -1398,6 +1443,7 @@ void spu_recompiler::STQX(spu_opcode_t op)
 		c->unuse(*qw1);
 	}
 
+	CheckCodeWrite();
 	c->unuse(*addr);
 }
 
@@ -2909,6 +2955,8 @@ void spu_recompiler::STQA(spu_opcode_t op)
 		c->unuse(*qw0);
 		c->unuse(*qw1);
 	}
+
+	CheckCodeWrite(spu_ls_target(0, op.i16));
 }
 
 void spu_recompiler::BRNZ(spu_opcode_t op)
@@ -3005,6 +3053,8 @@ void spu_recompiler::STQR(spu_opcode_t op)
 		c->unuse(*qw0);
 		c->unuse(*qw1);
 	}
+
+	CheckCodeWrite(spu_ls_target(m_pos, op.i16));
 }
 
 void spu_recompiler::BRA(spu_opcode_t op)
@@ -3277,6 +3327,7 @@ void spu_recompiler::STQD(spu_opcode_t op)
 		c->unuse(*qw1);
 	}
 
+	CheckCodeWrite();
 	c->unuse(*addr);
 }
 
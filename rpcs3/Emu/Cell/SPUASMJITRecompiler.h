@@ -80,6 +80,8 @@ private:
 
 public:
 	void CheckInterruptStatus(spu_opcode_t op);
+	void CheckCodeWrite();
+	void CheckCodeWrite(u32 lsa);
 	void InterpreterCall(spu_opcode_t op);
 	void FunctionCall();
 
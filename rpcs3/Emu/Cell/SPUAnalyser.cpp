@@ -1,18 +1,66 @@
 #include "stdafx.h"
+#include "Emu/System.h"
 #include "SPUAnalyser.h"
 #include "SPURecompiler.h"
 #include "SPUOpcodes.h"
 
-const spu_decoder<spu_itype> s_spu_itype;
+extern const spu_decoder<spu_itype> g_spu_itype{};
+
+// SPU Database file header
+struct spu_db_header
+{
+	u64 magic;
+	u32 version;
+	u32 count;
+};
+
+// SPU Database file entry (followed by function data, blocks, adjacent functions and jump table entries)
+struct spu_db_entry
+{
+	u32 addr;
+	u32 size;
+	u64 hash0;
+	u64 hash1;
+	u32 blocks;
+	u32 adjacent;
+	u32 jtable;
+	u32 does_reset_stack;
+};
+
+// "RPCS3SPU" as little-endian integer
+constexpr u64 s_spu_db_magic = 0x5550533353435052ull;
+
+// Must be incremented on any change in the file format or in the analyser
+constexpr u32 s_spu_db_version = 2;
 
 spu_function_t* SPUDatabase::find(const be_t<u32>* data, u64 key, u32 max_size)
 {
-	for (auto found = m_db.equal_range(key); found.first != found.second; found.first++)
+	const auto found = m_db.find(key);
+
+	if (LIKELY(found == m_db.end()))
+	{
+		return nullptr;
+	}
+
+	// Candidates are ordered by size, so the data is hashed only once
+	spu_hash_t hash;
+	u32 pos = 0;
+
+	for (const auto& func : found->second)
 	{
-		const auto& func = found.first->second;
+		if (func->size > max_size)
+		{
+			break;
+		}
+
+		// Extend the prefix hash up to the candidate size
+		for (; pos < func->size; pos += 4)
+		{
+			hash.update(data[pos / 4]);
+		}
 
-		// Compare binary data explicitly (TODO: optimize)
-		if (LIKELY(func->size <= max_size) && std::memcmp(func->data.data(), data, func->size) == 0)
+		// Confirm the hash hit
+		if (hash == func->hash && std::memcmp(func->data.data(), data, func->size) == 0)
 		{
 			return func.get();
 		}
@@ -21,16 +69,215 @@ spu_function_t* SPUDatabase::find(const be_t<u32>* data, u64 key, u32 max_size)
 	return nullptr;
 }
 
+void SPUDatabase::add(u64 key, std::shared_ptr<spu_function_t> func)
+{
+	auto& list = m_db[key];
+
+	const auto pos = std::upper_bound(list.begin(), list.end(), func->size, [](u32 size, const std::shared_ptr<spu_function_t>& other)
+	{
+		return size < other->size;
+	});
+
+	list.emplace(pos, std::move(func));
+	m_count++;
+}
+
+spu_hash_t SPUDatabase::get_hash(const be_t<u32>* data, u32 size)
+{
+	spu_hash_t hash;
+
+	for (u32 i = 0; i < size / 4; i++)
+	{
+		hash.update(data[i]);
+	}
+
+	return hash;
+}
+
+void SPUDatabase::load()
+{
+	const fs::file file(m_path);
+
+	if (!file)
+	{
+		return;
+	}
+
+	spu_db_header header;
+
+	if (!file.read(header) || header.magic != s_spu_db_magic)
+	{
+		LOG_ERROR(SPU, "SPU Database: invalid cache file (%s)", m_path);
+		return;
+	}
+
+	if (header.version != s_spu_db_version)
+	{
+		LOG_WARNING(SPU, "SPU Database: outdated cache file ignored (version %u)", header.version);
+		return;
+	}
+
+	// Read set of LS addresses within [min, max)
+	auto read_set = [&](std::set<u32>& out, u32 count, u32 min, u32 max) -> bool
+	{
+		if (count > 0x10000)
+		{
+			return false;
+		}
+
+		std::vector<u32> addrs(count);
+
+		if (!file.read(addrs))
+		{
+			return false;
+		}
+
+		for (const u32 addr : addrs)
+		{
+			if (addr % 4 || addr < min || addr >= max)
+			{
+				return false;
+			}
+
+			out.emplace_hint(out.end(), addr);
+		}
+
+		return true;
+	};
+
+	for (u32 i = 0; i < header.count; i++)
+	{
+		spu_db_entry entry;
+
+		if (!file.read(entry) || entry.addr % 4 || entry.size % 4 || !entry.size || entry.addr >= 0x40000 || entry.size > 0x40000 - entry.addr)
+		{
+			LOG_ERROR(SPU, "SPU Database: corrupted cache file (entry %u)", i);
+			m_db.clear();
+			m_count = 0;
+			return;
+		}
+
+		auto func = std::make_shared<spu_function_t>(entry.addr, entry.size);
+		func->data.resize(entry.size / 4);
+		func->hash.h0 = entry.hash0;
+		func->hash.h1 = entry.hash1;
+		func->does_reset_stack = entry.does_reset_stack != 0;
+
+		if (file.read(func->data.data(), entry.size) != entry.size || get_hash(func->data.data(), entry.size) != func->hash ||
+			!read_set(func->blocks, entry.blocks, entry.addr, entry.addr + entry.size) ||
+			!read_set(func->adjacent, entry.adjacent, 0, 0x40000) ||
+			!read_set(func->jtable, entry.jtable, entry.addr, entry.addr + entry.size))
+		{
+			LOG_ERROR(SPU, "SPU Database: corrupted cache file (function 0x%05x)", entry.addr);
+			m_db.clear();
+			m_count = 0;
+			return;
+		}
+
+		add(entry.addr | u64{ func->data[0] } << 32, std::move(func));
+	}
+
+	m_saved = m_count;
+}
+
+void SPUDatabase::save()
+{
+	if (m_count == m_saved)
+	{
+		// Nothing new
+		return;
+	}
+
+	std::vector<u8> buf;
+
+	auto push = [&](const void* data, std::size_t size)
+	{
+		buf.insert(buf.end(), static_cast<const u8*>(data), static_cast<const u8*>(data) + size);
+	};
+
+	auto push_set = [&](const std::set<u32>& addrs)
+	{
+		for (const u32 addr : addrs)
+		{
+			push(&addr, sizeof(addr));
+		}
+	};
+
+	const spu_db_header header{s_spu_db_magic, s_spu_db_version, ::narrow<u32>(m_count)};
+	push(&header, sizeof(header));
+
+	for (const auto& pair : m_db)
+	{
+		for (const auto& ptr : pair.second)
+		{
+			const auto& func = *ptr;
+
+			const spu_db_entry entry{func.addr, func.size, func.hash.h0, func.hash.h1, ::size32(func.blocks), ::size32(func.adjacent), ::size32(func.jtable), func.does_reset_stack};
+			push(&entry, sizeof(entry));
+			push(func.data.data(), func.size);
+			push_set(func.blocks);
+			push_set(func.adjacent);
+			push_set(func.jtable);
+		}
+	}
+
+	// Write to temporary file first to never leave a partially written database
+	const std::string tmp_path = m_path + ".tmp";
+
+	if (fs::file file{tmp_path, fs::rewrite})
+	{
+		if (file.write(buf.data(), buf.size()) == buf.size())
+		{
+			file.close();
+
+			if (fs::rename(tmp_path, m_path, true))
+			{
+				LOG_SUCCESS(SPU, "SPU Database: %u functions saved", m_count);
+				m_saved = m_count;
+				return;
+			}
+		}
+	}
+
+	LOG_ERROR(SPU, "SPU Database: failed to save %s (%s)", m_path, fs::g_tls_error);
+}
+
 SPUDatabase::SPUDatabase()
 {
-	// TODO: load existing database associated with currently running executable
+	if (g_cfg.core.spu_cache && !Emu.GetCachePath().empty())
+	{
+		// Load existing database associated with currently running executable
+		m_path = Emu.GetCachePath() + "SPU.db";
+		load();
+	}
 
-	LOG_SUCCESS(SPU, "SPU Database initialized...");
+	LOG_SUCCESS(SPU, "SPU Database initialized (%u functions loaded)...", m_count);
 }
 
 SPUDatabase::~SPUDatabase()
 {
-	// TODO: serialize database
+	if (!m_path.empty())
+	{
+		save();
+	}
+}
+
+std::vector<spu_function_t*> SPUDatabase::get_functions()
+{
+	reader_lock lock(m_mutex);
+
+	std::vector<spu_function_t*> result;
+	result.reserve(m_count);
+
+	for (const auto& pair : m_db)
+	{
+		for (const auto& func : pair.second)
+		{
+			result.emplace_back(func.get());
+		}
+	}
+
+	return result;
 }
 
 spu_function_t* SPUDatabase::analyse(const be_t<u32>* ls, u32 entry, u32 max_limit)
@@ -41,7 +288,7 @@ spu_function_t* SPUDatabase::analyse(const be_t<u32>* ls, u32 entry, u32 max_lim
 		fmt::throw_exception("Invalid arguments (entry=0x%05x, limit=0x%05x)" HERE, entry, max_limit);
 	}
 
-	// Key for multimap
+	// Key for the database
 	const u64 key = entry | u64{ ls[entry / 4] } << 32;
 	const be_t<u32>* base = ls + entry / 4;
 	const u32 block_sz = max_limit - entry;
@@ -86,7 +333,7 @@ spu_function_t* SPUDatabase::analyse(const be_t<u32>* ls, u32 entry, u32 max_lim
 	{
 		const spu_opcode_t op{ ls[pos / 4] };
 
-		const auto type = s_spu_itype.decode(op.opcode);
+		const auto type = g_spu_itype.decode(op.opcode);
 
 		{
 			reader_lock lock(m_mutex);
@@ -283,7 +530,7 @@ spu_function_t* SPUDatabase::analyse(const be_t<u32>* ls, u32 entry, u32 max_lim
 	{
 		const spu_opcode_t op{ ls[pos / 4] };
 
-		const auto type = s_spu_itype.decode(op.opcode);
+		const auto type = g_spu_itype.decode(op.opcode);
 
 		if (type == BRSL || type == BRASL) // Branch Relative/Absolute and Set Link
 		{
@@ -343,13 +590,16 @@ spu_function_t* SPUDatabase::analyse(const be_t<u32>* ls, u32 entry, u32 max_lim
 	// Set whether the function can reset stack
 	func->does_reset_stack = ila_sp_pos < limit;
 
+	// Set content hash
+	func->hash = get_hash(func->data.data(), func->size);
+
 	// Lock here just before we write to the db
 	// Its is unlikely that the second check will pass anyway so we delay this step since compiling functions is very fast
 	{
 		writer_lock lock(m_mutex);
 
 		// Add function to the database
-		m_db.emplace(key, func);
+		add(key, func);
 	}
 
 	LOG_NOTICE(SPU, "Function detected [0x%05x-0x%05x] (size=0x%x)", func->addr, func->addr + func->size, func->size);
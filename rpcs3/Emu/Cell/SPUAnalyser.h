@@ -246,6 +246,42 @@ struct spu_itype
 
 class SPUThread;
 
+// SPU function content hash (two polynomial hashes modulo 2^61-1, extended one instruction at a time)
+struct spu_hash_t
+{
+	static constexpr u64 mod = (1ull << 61) - 1;
+
+	u64 h0 = 0;
+	u64 h1 = 0;
+
+	// Multiply modulo 2^61-1 (arguments must be less than the modulus)
+	static u64 mulmod(u64 a, u64 b)
+	{
+		const u64 lo = a * b;
+		const u64 r = (lo & mod) + (lo >> 61 | umulh64(a, b) << 3);
+		return r >= mod ? r - mod : r;
+	}
+
+	// Append instruction
+	void update(u32 op)
+	{
+		h0 = mulmod(h0, 0x1b873593a2b1c3d5ull & mod) + op + 1;
+		h1 = mulmod(h1, 0x0cc9e2d51e3779b9ull & mod) + op + 1;
+		h0 = h0 >= mod ? h0 - mod : h0;
+		h1 = h1 >= mod ? h1 - mod : h1;
+	}
+
+	bool operator ==(const spu_hash_t& rhs) const
+	{
+		return h0 == rhs.h0 && h1 == rhs.h1;
+	}
+
+	bool operator !=(const spu_hash_t& rhs) const
+	{
+		return h0 != rhs.h0 || h1 != rhs.h1;
+	}
+};
+
 // SPU basic function information structure
 struct spu_function_t
 {
@@ -270,8 +306,14 @@ struct spu_function_t
 	// Whether ila $SP,* instruction found
 	bool does_reset_stack;
 
-	// Pointer to the compiled function
-	u32(*compiled)(SPUThread* _spu, be_t<u32>* _ls) = nullptr;
+	// Content hash (function contents)
+	spu_hash_t hash;
+
+	// Pointer to the compiled function (set by the compiler thread, published after the code is written)
+	atomic_t<u32(*)(SPUThread* _spu, be_t<u32>* _ls)> compiled{nullptr};
+
+	// Whether the function was queued for asynchronous compilation
+	atomic_t<bool> queued{false};
 
 	spu_function_t(u32 addr, u32 size)
 		: addr(addr)
@@ -285,11 +327,27 @@ class SPUDatabase final : spu_itype
 {
 	shared_mutex m_mutex;
 
-	// All registered functions (uses addr and first instruction as a key)
-	std::unordered_multimap<u64, std::shared_ptr<spu_function_t>> m_db;
+	// All registered functions (uses addr and first instruction as a key, ordered by size)
+	std::unordered_map<u64, std::vector<std::shared_ptr<spu_function_t>>> m_db;
+
+	// Number of registered functions
+	std::size_t m_count = 0;
+
+	// Cache file path (empty if disabled)
+	std::string m_path;
+
+	// Number of functions loaded from or saved to the cache file
+	std::size_t m_saved = 0;
 
 	// For internal use
 	spu_function_t* find(const be_t<u32>* data, u64 key, u32 max_size);
+	void add(u64 key, std::shared_ptr<spu_function_t> func);
+
+	// Load functions from the cache file
+	void load();
+
+	// Save all functions to the cache file
+	void save();
 
 public:
 	SPUDatabase();
@@ -297,4 +355,10 @@ public:
 
 	// Try to retrieve SPU function information
 	spu_function_t* analyse(const be_t<u32>* ls, u32 entry, u32 limit = 0x40000);
+
+	// Get all known functions (used to warm up the recompiler)
+	std::vector<spu_function_t*> get_functions();
+
+	// Compute content hash of the function data
+	static spu_hash_t get_hash(const be_t<u32>* data, u32 size);
 };
@@ -1,11 +1,17 @@
 #include "stdafx.h"
 #include "Emu/IdManager.h"
 #include "Emu/Memory/Memory.h"
+#include "Emu/System.h"
 
 #include "SPUThread.h"
 #include "SPURecompiler.h"
+#include "SPUInterpreter.h"
 #include "SPUASMJITRecompiler.h"
 #include <algorithm>
+#include <thread>
+
+extern const spu_decoder<spu_interpreter_fast> g_spu_interpreter_fast;
+extern const spu_decoder<spu_itype> g_spu_itype;
 
 extern u64 get_system_time();
 
@@ -13,79 +19,331 @@ spu_recompiler_base::~spu_recompiler_base()
 {
 }
 
-void spu_recompiler_base::enter(SPUThread& spu)
+spu_compiler_pool::spu_compiler_pool(std::shared_ptr<SPUDatabase> db)
+	: m_db(std::move(db))
 {
-	if (spu.pc >= 0x40000 || spu.pc % 4)
+	// Initialize the number of worker threads
+	const u32 max_threads = static_cast<u32>(g_cfg.core.spu_compile_threads);
+	const u32 hw_threads = std::max<u32>(std::thread::hardware_concurrency(), 1);
+	const u32 thread_count = max_threads > 0 ? std::min(max_threads, hw_threads) : std::max<u32>(hw_threads / 2, 1);
+
+	for (u32 i = 0; i < thread_count; i++)
 	{
-		fmt::throw_exception("Invalid PC: 0x%05x", spu.pc);
+		m_workers.emplace_back();
+
+		thread_ctrl::spawn(m_workers.back(), fmt::format("SPU Compiler %u", i), [this]()
+		{
+			// Each worker owns its recompiler instance
+			const auto rec = std::make_shared<spu_recompiler>();
+
+			while (true)
+			{
+				spu_function_t* func;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+
+					m_cond.wait(lock, [&] { return m_exit || !m_queue.empty(); });
+
+					if (m_exit)
+					{
+						return;
+					}
+
+					func = m_queue.front();
+					m_queue.pop_front();
+					m_busy++;
+				}
+
+				try
+				{
+					rec->compile(*func);
+				}
+				catch (const std::exception& e)
+				{
+					// Function will stay interpreted
+					LOG_ERROR(SPU, "Compilation failed (0x%05x): %s", func->addr, e.what());
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+
+					if (!--m_busy && m_queue.empty())
+					{
+						m_done.notify_all();
+					}
+				}
+			}
+		});
 	}
 
-	// Get SPU LS pointer
-	const auto _ls = vm::_ptr<u32>(spu.offset);
+	LOG_SUCCESS(SPU, "SPU Compiler pool created (%u threads)...", thread_count);
+}
 
-	// Search if cached data matches
-	auto func = spu.compiled_cache[spu.pc / 4];
+spu_compiler_pool::~spu_compiler_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exit = true;
+	}
+
+	m_cond.notify_all();
 
-	// Check shared db if we dont have a match
-	if (!func || !std::equal(func->data.begin(), func->data.end(), _ls + spu.pc / 4, [](const be_t<u32>& l, const be_t<u32>& r) { return *(u32*)(u8*)&l == *(u32*)(u8*)&r; }))
+	for (auto& worker : m_workers)
 	{
-		func = spu.spu_db->analyse(_ls, spu.pc);
-		spu.compiled_cache[spu.pc / 4] = func;
+		worker->join();
 	}
+}
 
-	// Reset callstack if necessary
-	if ((func->does_reset_stack && spu.recursion_level) || spu.recursion_level >= 128)
+void spu_compiler_pool::push(spu_function_t& func)
+{
+	if (func.compiled.load() || func.queued.exchange(true))
 	{
-		spu.state += cpu_flag::ret;
 		return;
 	}
 
-	// Compile if needed
-	if (!func->compiled)
 	{
-		if (!spu.spu_rec)
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.emplace_back(&func);
+	}
+
+	m_cond.notify_one();
+}
+
+void spu_compiler_pool::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (!m_queue.empty() || m_busy)
+	{
+		if (Emu.IsStopped())
 		{
-			spu.spu_rec = fxm::get_always<spu_recompiler>();
+			return;
 		}
 
-		spu.spu_rec->compile(*func);
+		m_done.wait_for(lock, std::chrono::milliseconds(100));
+	}
+}
 
-		if (!func->compiled) fmt::throw_exception("Compilation failed" HERE);
+extern void spu_initialize()
+{
+	if (g_cfg.core.spu_decoder != spu_decoder_type::asmjit || !g_cfg.core.spu_cache)
+	{
+		return;
 	}
 
-	const u32 res = func->compiled(&spu, _ls);
+	// Load SPU function database and warm up the recompiler before any SPU thread starts
+	const auto db = fxm::get_always<SPUDatabase>();
+	const auto funcs = db->get_functions();
 
-	if (const auto exception = spu.pending_exception)
+	if (funcs.empty())
 	{
-		spu.pending_exception = nullptr;
-		std::rethrow_exception(exception);
+		return;
 	}
 
-	if (res & 0x1000000)
+	if (g_cfg.core.spu_async_compile)
 	{
-		spu.halt();
-	}
+		const auto pool = fxm::get_always<spu_compiler_pool>(db);
 
-	if (res & 0x2000000)
+		for (const auto func : funcs)
+		{
+			pool->push(*func);
+		}
+
+		pool->wait();
+	}
+	else
 	{
+		const auto rec = fxm::get_always<spu_recompiler>();
+
+		for (const auto func : funcs)
+		{
+			if (Emu.IsStopped())
+			{
+				return;
+			}
+
+			rec->compile(*func);
+		}
 	}
 
-	if (res & 0x4000000)
+	LOG_SUCCESS(SPU, "SPU Database: %u functions precompiled", funcs.size());
+}
+
+void spu_recompiler_base::enter(SPUThread& spu)
+{
+	// Get SPU LS pointer
+	const auto _ls = vm::_ptr<u32>(spu.offset);
+
+	// Execute compiled functions back-to-back while nothing requires returning to the caller
+	while (true)
 	{
-		if (res & 0x8000000)
+		if (spu.pc >= 0x40000 || spu.pc % 4)
+		{
+			fmt::throw_exception("Invalid PC: 0x%05x", spu.pc);
+		}
+
+		const u32 stamp = spu.ls_stamp;
+
+		// Search if cached data matches
+		auto func = spu.compiled_cache[spu.pc / 4];
+
+		// Compare function contents only if some of its lines were written since the last check
+		if (func && spu.compiled_stamp[spu.pc / 4] != stamp && spu.is_code_modified(func->addr, func->size, spu.compiled_stamp[spu.pc / 4]))
+		{
+			if (std::memcmp(func->data.data(), _ls + spu.pc / 4, func->size) != 0)
+			{
+				func = nullptr;
+			}
+		}
+
+		// Check shared db if we dont have a match
+		if (!func)
 		{
-			fmt::throw_exception("Invalid interrupt status set (0x%x)" HERE, res);
+			func = spu.spu_db->analyse(_ls, spu.pc);
+			spu.set_code_lines(func->addr, func->size);
+
+			// Writes done during the analysis, before the lines were marked, were not stamped
+			if (std::memcmp(func->data.data(), _ls + spu.pc / 4, func->size) != 0)
+			{
+				spu.compiled_cache[spu.pc / 4] = nullptr;
+				continue;
+			}
+
+			spu.compiled_cache[spu.pc / 4] = func;
+		}
+
+		spu.compiled_stamp[spu.pc / 4] = stamp;
+
+		// Reset callstack if necessary
+		if ((func->does_reset_stack && spu.recursion_level) || spu.recursion_level >= 128)
+		{
+			spu.state += cpu_flag::ret;
+			return;
+		}
+
+		auto compiled = func->compiled.load();
+
+		// Compile if needed
+		if (!compiled)
+		{
+			if (g_cfg.core.spu_async_compile)
+			{
+				if (!spu.spu_pool)
+				{
+					spu.spu_pool = fxm::get_always<spu_compiler_pool>(spu.spu_db);
+				}
+
+				// Queue compilation and interpret the function meanwhile
+				spu.spu_pool->push(*func);
+
+				return interpret(spu, *func);
+			}
+
+			if (!spu.spu_rec)
+			{
+				spu.spu_rec = fxm::get_always<spu_recompiler>();
+			}
+
+			spu.spu_rec->compile(*func);
+
+			compiled = func->compiled.load();
+
+			if (!compiled) fmt::throw_exception("Compilation failed" HERE);
+		}
+
+		const u32 res = compiled(&spu, _ls);
+
+		if (const auto exception = spu.pending_exception)
+		{
+			spu.pending_exception = nullptr;
+			std::rethrow_exception(exception);
+		}
+
+		if (res & 0x1000000)
+		{
+			spu.halt();
+		}
+
+		if (res & 0x2000000)
+		{
+		}
+
+		if (res & 0x4000000)
+		{
+			if (res & 0x8000000)
+			{
+				fmt::throw_exception("Invalid interrupt status set (0x%x)" HERE, res);
+			}
+
+			spu.set_interrupt_status(true);
+		}
+		else if (res & 0x8000000)
+		{
+			spu.set_interrupt_status(false);
 		}
 
-		spu.set_interrupt_status(true);
+		spu.pc = res & 0x3fffc;
+
+		check_interrupts(spu);
+
+		// Return on status change or when the caller's link is reached (see spu_recompiler::FunctionCall)
+		if (res & 0xf000000 || test(spu.state) || spu.pc == spu.call_link)
+		{
+			return;
+		}
 	}
-	else if (res & 0x8000000)
+}
+
+void spu_recompiler_base::interpret(SPUThread& spu, const spu_function_t& func)
+{
+	const auto& table = g_spu_interpreter_fast.get_table();
+	const auto _ls = vm::_ptr<const be_t<u32>>(spu.offset);
+
+	do
 	{
-		spu.set_interrupt_status(false);
+		if (UNLIKELY(test(spu.state)) && spu.check_state())
+		{
+			return;
+		}
+
+		const spu_opcode_t op{_ls[spu.pc / 4]};
+
+		// Get LS address written by the store instruction (stores to code lines must be tracked)
+		bool is_store = true;
+		u32 store_lsa = 0;
+
+		switch (g_spu_itype.decode(op.opcode))
+		{
+		case spu_itype::STQD: store_lsa = (spu.gpr[op.ra]._s32[3] + (op.si10 << 4)) & 0x3fff0; break;
+		case spu_itype::STQX: store_lsa = (spu.gpr[op.ra]._u32[3] + spu.gpr[op.rb]._u32[3]) & 0x3fff0; break;
+		case spu_itype::STQA: store_lsa = spu_ls_target(0, op.i16); break;
+		case spu_itype::STQR: store_lsa = spu_ls_target(spu.pc, op.i16); break;
+		default: is_store = false; break;
+		}
+
+		if (table[spu_decode(op.opcode)](spu, op))
+		{
+			spu.pc += 4;
+		}
+
+		if (is_store)
+		{
+			spu.on_ls_write(store_lsa, 16);
+		}
+
+		if (UNLIKELY(spu.pc == func.addr) && func.compiled.load())
+		{
+			// Compilation finished, compiled code can only be entered at the function start
+			break;
+		}
 	}
+	while (spu.pc >= func.addr && spu.pc < func.addr + func.size);
 
-	spu.pc = res & 0x3fffc;
+	check_interrupts(spu);
+}
 
+void spu_recompiler_base::check_interrupts(SPUThread& spu)
+{
 	if (spu.interrupts_enabled && (spu.ch_event_mask & spu.ch_event_stat & SPU_EVENT_INTR_IMPLEMENTED) > 0)
 	{
 		spu.interrupts_enabled = false;
@@ -3,6 +3,10 @@
 #include "SPUAnalyser.h"
 
 #include <mutex>
+#include <deque>
+#include <condition_variable>
+
+class thread_ctrl;
 
 // SPU Recompiler instance base (must be global or PS3 process-local)
 class spu_recompiler_base
@@ -22,4 +26,42 @@ public:
 
 	// Run
 	static void enter(class SPUThread&);
+
+private:
+	// Run interpreter until the function is left or its start is reached once compiled (used while it's being compiled)
+	static void interpret(class SPUThread&, const spu_function_t&);
+
+	// Enter interrupt handler if necessary
+	static void check_interrupts(class SPUThread&);
+};
+
+// SPU asynchronous compilation worker pool (must be global or PS3 process-local)
+class spu_compiler_pool
+{
+	// Keeps functions alive while compiling
+	const std::shared_ptr<SPUDatabase> m_db;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cond; // new function queued or exit requested
+	std::condition_variable m_done; // queue drained
+
+	// Functions waiting for compilation
+	std::deque<spu_function_t*> m_queue;
+
+	// Number of functions being compiled
+	u32 m_busy = 0;
+
+	bool m_exit = false;
+
+	std::vector<std::shared_ptr<thread_ctrl>> m_workers;
+
+public:
+	spu_compiler_pool(std::shared_ptr<SPUDatabase> db);
+	~spu_compiler_pool();
+
+	// Queue function for compilation (does nothing if already queued)
+	void push(spu_function_t& func);
+
+	// Wait until all queued functions are compiled
+	void wait();
 };
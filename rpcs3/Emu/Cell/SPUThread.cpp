@@ -42,6 +42,142 @@ bool operator ==(const u128& lhs, const u128& rhs)
 }
 #endif
 
+// DMA copy routines (size is a multiple of 16, both buffers are 16-byte aligned)
+static void spu_dma_copy_sse2(void* dst, const void* src, u32 size)
+{
+	auto vdst = static_cast<__m128i*>(dst);
+	auto vsrc = static_cast<const __m128i*>(src);
+	auto vcnt = size / sizeof(__m128i);
+
+	while (vcnt >= 8)
+	{
+		const __m128i data[]
+		{
+			_mm_load_si128(vsrc + 0),
+			_mm_load_si128(vsrc + 1),
+			_mm_load_si128(vsrc + 2),
+			_mm_load_si128(vsrc + 3),
+			_mm_load_si128(vsrc + 4),
+			_mm_load_si128(vsrc + 5),
+			_mm_load_si128(vsrc + 6),
+			_mm_load_si128(vsrc + 7),
+		};
+
+		_mm_store_si128(vdst + 0, data[0]);
+		_mm_store_si128(vdst + 1, data[1]);
+		_mm_store_si128(vdst + 2, data[2]);
+		_mm_store_si128(vdst + 3, data[3]);
+		_mm_store_si128(vdst + 4, data[4]);
+		_mm_store_si128(vdst + 5, data[5]);
+		_mm_store_si128(vdst + 6, data[6]);
+		_mm_store_si128(vdst + 7, data[7]);
+
+		vcnt -= 8;
+		vsrc += 8;
+		vdst += 8;
+	}
+
+	while (vcnt--)
+	{
+		_mm_store_si128(vdst++, _mm_load_si128(vsrc++));
+	}
+}
+
+#ifdef _MSC_VER
+static void spu_dma_copy_avx2(void* dst, const void* src, u32 size)
+#else
+__attribute__((__target__("avx2"))) static void spu_dma_copy_avx2(void* dst, const void* src, u32 size)
+#endif
+{
+	auto vdst = static_cast<u8*>(dst);
+	auto vsrc = static_cast<const u8*>(src);
+
+	while (size >= 128)
+	{
+		const __m256i data[]
+		{
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(vsrc + 0)),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(vsrc + 32)),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(vsrc + 64)),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(vsrc + 96)),
+		};
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(vdst + 0), data[0]);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(vdst + 32), data[1]);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(vdst + 64), data[2]);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(vdst + 96), data[3]);
+
+		size -= 128;
+		vsrc += 128;
+		vdst += 128;
+	}
+
+	while (size >= 32)
+	{
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(vdst), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vsrc)));
+
+		size -= 32;
+		vsrc += 32;
+		vdst += 32;
+	}
+
+	if (size)
+	{
+		_mm_store_si128(reinterpret_cast<__m128i*>(vdst), _mm_load_si128(reinterpret_cast<const __m128i*>(vsrc)));
+	}
+
+	_mm256_zeroupper();
+}
+
+// Non-temporal copy for large PUT transfers
+static void spu_dma_copy_stream(void* dst, const void* src, u32 size)
+{
+	auto vdst = static_cast<__m128i*>(dst);
+	auto vsrc = static_cast<const __m128i*>(src);
+	auto vcnt = size / sizeof(__m128i);
+
+	while (vcnt >= 8)
+	{
+		const __m128i data[]
+		{
+			_mm_load_si128(vsrc + 0),
+			_mm_load_si128(vsrc + 1),
+			_mm_load_si128(vsrc + 2),
+			_mm_load_si128(vsrc + 3),
+			_mm_load_si128(vsrc + 4),
+			_mm_load_si128(vsrc + 5),
+			_mm_load_si128(vsrc + 6),
+			_mm_load_si128(vsrc + 7),
+		};
+
+		_mm_stream_si128(vdst + 0, data[0]);
+		_mm_stream_si128(vdst + 1, data[1]);
+		_mm_stream_si128(vdst + 2, data[2]);
+		_mm_stream_si128(vdst + 3, data[3]);
+		_mm_stream_si128(vdst + 4, data[4]);
+		_mm_stream_si128(vdst + 5, data[5]);
+		_mm_stream_si128(vdst + 6, data[6]);
+		_mm_stream_si128(vdst + 7, data[7]);
+
+		vcnt -= 8;
+		vsrc += 8;
+		vdst += 8;
+	}
+
+	while (vcnt--)
+	{
+		_mm_stream_si128(vdst++, _mm_load_si128(vsrc++));
+	}
+
+	// Make streamed data visible before the transfer is reported complete
+	_mm_sfence();
+}
+
+static void(*const s_dma_copy)(void*, const void*, u32) = utils::has_avx2() ? spu_dma_copy_avx2 : spu_dma_copy_sse2;
+
+// Minimal PUT size for non-temporal stores
+static constexpr u32 s_dma_stream_threshold = 4096;
+
 extern u64 get_timebased_time();
 extern u64 get_system_time();
 
@@ -321,6 +457,9 @@ std::string SPUThread::dump() const
 
 void SPUThread::cpu_init()
 {
+	// LS image may have been reloaded
+	on_ls_write(0, 0x40000);
+
 	gpr = {};
 	fpscr.Reset();
 
@@ -501,6 +640,56 @@ void SPUThread::push_snr(u32 number, u32 value)
 	}
 }
 
+// Can be called concurrently with the owner thread (MMIO PUT from other SPUs, sys_spu_thread_write_ls).
+// PPU stores to the LS of a running Raw SPU are still not tracked, only restarting it invalidates the cache.
+void SPUThread::on_ls_write(u32 lsa, u32 size)
+{
+	if (!size)
+	{
+		return;
+	}
+
+	// Stamp modified code lines with the next ls_stamp value before publishing it
+	const u32 stamp = ls_stamp + 1;
+
+	bool modified = false;
+
+	for (u32 line = lsa / 128; line <= (lsa + size - 1) / 128 && line < 2048; line++)
+	{
+		if (ls_code_lines[line / 64] & (1ull << (line % 64)))
+		{
+			ls_line_stamp[line] = stamp;
+			modified = true;
+		}
+	}
+
+	if (modified)
+	{
+		ls_stamp++;
+	}
+}
+
+void SPUThread::set_code_lines(u32 lsa, u32 size)
+{
+	for (u32 line = lsa / 128; line <= (lsa + size - 1) / 128; line++)
+	{
+		ls_code_lines[line / 64] |= 1ull << (line % 64);
+	}
+}
+
+bool SPUThread::is_code_modified(u32 lsa, u32 size, u32 stamp) const
+{
+	for (u32 line = lsa / 128; line <= (lsa + size - 1) / 128; line++)
+	{
+		if (static_cast<s32>(ls_line_stamp[line] - stamp) > 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void SPUThread::do_dma_transfer(const spu_mfc_cmd& args, bool from_mfc)
 {
 	const bool is_get = (args.cmd & ~(MFC_BARRIER_MASK | MFC_FENCE_MASK)) == MFC_GET_CMD;
@@ -508,6 +697,9 @@ void SPUThread::do_dma_transfer(const spu_mfc_cmd& args, bool from_mfc)
 	u32 eal = args.eal;
 	u32 lsa = args.lsa & 0x3ffff;
 
+	// SPU thread whose LS is written by PUT (notified after the transfer)
+	SPUThread* ls_target = nullptr;
+
 	if (eal >= SYS_SPU_THREAD_BASE_LOW && offset < RAW_SPU_BASE_ADDR) // SPU Thread Group MMIO (LS and SNR)
 	{
 		const u32 index = (eal - SYS_SPU_THREAD_BASE_LOW) / SYS_SPU_THREAD_OFFSET; // thread number in group
@@ -520,6 +712,11 @@ void SPUThread::do_dma_transfer(const spu_mfc_cmd& args, bool from_mfc)
 			if (offset + args.size - 1 < 0x40000) // LS access
 			{
 				eal = spu.offset + offset; // redirect access
+
+				if (!is_get)
+				{
+					ls_target = &spu;
+				}
 			}
 			else if (!is_get && args.size == 4 && (offset == SYS_SPU_THREAD_SNR1 || offset == SYS_SPU_THREAD_SNR2))
 			{
@@ -583,87 +780,60 @@ void SPUThread::do_dma_transfer(const spu_mfc_cmd& args, bool from_mfc)
 	}
 	default:
 	{
-		auto vdst = static_cast<__m128i*>(dst);
-		auto vsrc = static_cast<const __m128i*>(src);
-		auto vcnt = size / sizeof(__m128i);
-
-		//if (is_get && !from_mfc)
+		// Large PUT data is unlikely to be read back soon, don't pollute the cache with it
+		if (!is_get && size >= s_dma_stream_threshold)
 		{
-			while (vcnt >= 8)
-			{
-				const __m128i data[]
-				{
-					_mm_load_si128(vsrc + 0),
-					_mm_load_si128(vsrc + 1),
-					_mm_load_si128(vsrc + 2),
-					_mm_load_si128(vsrc + 3),
-					_mm_load_si128(vsrc + 4),
-					_mm_load_si128(vsrc + 5),
-					_mm_load_si128(vsrc + 6),
-					_mm_load_si128(vsrc + 7),
-				};
-
-				_mm_store_si128(vdst + 0, data[0]);
-				_mm_store_si128(vdst + 1, data[1]);
-				_mm_store_si128(vdst + 2, data[2]);
-				_mm_store_si128(vdst + 3, data[3]);
-				_mm_store_si128(vdst + 4, data[4]);
-				_mm_store_si128(vdst + 5, data[5]);
-				_mm_store_si128(vdst + 6, data[6]);
-				_mm_store_si128(vdst + 7, data[7]);
-
-				vcnt -= 8;
-				vsrc += 8;
-				vdst += 8;
-			}
-
-			while (vcnt--)
-			{
-				_mm_store_si128(vdst++, _mm_load_si128(vsrc++));
-			}
-
+			spu_dma_copy_stream(dst, src, size);
 			break;
 		}
 
-		// Disabled
-		while (vcnt >= 8)
-		{
-			const __m128i data[]
-			{
-				_mm_load_si128(vsrc + 0),
-				_mm_load_si128(vsrc + 1),
-				_mm_load_si128(vsrc + 2),
-				_mm_load_si128(vsrc + 3),
-				_mm_load_si128(vsrc + 4),
-				_mm_load_si128(vsrc + 5),
-				_mm_load_si128(vsrc + 6),
-				_mm_load_si128(vsrc + 7),
-			};
-
-			_mm_stream_si128(vdst + 0, data[0]);
-			_mm_stream_si128(vdst + 1, data[1]);
-			_mm_stream_si128(vdst + 2, data[2]);
-			_mm_stream_si128(vdst + 3, data[3]);
-			_mm_stream_si128(vdst + 4, data[4]);
-			_mm_stream_si128(vdst + 5, data[5]);
-			_mm_stream_si128(vdst + 6, data[6]);
-			_mm_stream_si128(vdst + 7, data[7]);
+		s_dma_copy(dst, src, size);
+		break;
+	}
+	}
 
-			vcnt -= 8;
-			vsrc += 8;
-			vdst += 8;
-		}
+	if (is_get)
+	{
+		on_ls_write(lsa, args.size);
+	}
+	else if (ls_target)
+	{
+		ls_target->on_ls_write(eal - ls_target->offset, args.size);
+	}
+}
 
-		while (vcnt--)
-		{
-			_mm_stream_si128(vdst++, _mm_load_si128(vsrc++));
-		}
+void spu_dma_list_batch::push(const spu_mfc_cmd& transfer)
+{
+	if (m_cmd.size &&
+		transfer.size % 16 == 0 &&
+		m_cmd.eal + m_cmd.size == transfer.eal &&
+		m_cmd.lsa + m_cmd.size == transfer.lsa &&
+		(m_cmd.lsa & 0x3ffff) + m_cmd.size + transfer.size <= 0x40000)
+	{
+		m_cmd.size += transfer.size;
+	}
+	else
+	{
+		flush();
+		m_cmd = transfer;
 	}
+
+	const bool is_get = (m_cmd.cmd & ~(MFC_BARRIER_MASK | MFC_FENCE_MASK)) == MFC_GET_CMD;
+	const u32 lsa = m_cmd.lsa & 0x3ffff;
+
+	// Small and MMIO transfers aren't merged, GET overwriting the list must complete before the next element is read
+	if (m_cmd.size % 16 || m_cmd.eal >= SYS_SPU_THREAD_BASE_LOW || (is_get && lsa < m_list_end && lsa + m_cmd.size > m_list_lsa))
+	{
+		flush();
 	}
+}
 
-	if (is_get && from_mfc)
+void spu_dma_list_batch::flush()
+{
+	if (m_cmd.size)
 	{
-		//_mm_sfence();
+		m_spu.do_dma_transfer(m_cmd);
+		m_cmd.size = 0;
 	}
 }
 
@@ -684,10 +854,45 @@ void SPUThread::process_mfc_cmd()
 				return;
 			}
 
-			// TODO: investigate lost notifications
-			std::this_thread::yield();
-			_mm_lfence();
+			// Request notification, then check again to not miss the entry freed meanwhile
+			mfc_queue_wait = true;
+
+			if (mfc_queue.size() < 16)
+			{
+				mfc_queue_wait = false;
+				return;
+			}
+
+			mfc->notify();
+			thread_ctrl::wait();
+		}
+	};
+
+	// Check whether the command must be executed after some queued command
+	auto is_ordered = [&]()
+	{
+		if (mfc_queue.size() == 0)
+		{
+			return false;
+		}
+
+		if (ch_mfc_cmd.cmd & (MFC_BARRIER_MASK | MFC_FENCE_MASK))
+		{
+			return true;
+		}
+
+		for (u32 i = 0; i < 16; i++)
+		{
+			const auto& _cmd = mfc_queue.get_push(i);
+
+			// Pending command with the same tag or barrier (unused entries may only produce false positives)
+			if (_cmd.size && (_cmd.tag == ch_mfc_cmd.tag || (_cmd.cmd & ~0xc) == MFC_BARRIER_CMD))
+			{
+				return true;
+			}
 		}
+
+		return false;
 	};
 
 	switch (ch_mfc_cmd.cmd)
@@ -699,6 +904,8 @@ void SPUThread::process_mfc_cmd()
 		const u32 _addr = ch_mfc_cmd.eal;
 		const u64 _time = vm::reservation_acquire(raddr, 128);
 
+		vm::reservation_stat(_addr, id, vm::reservation_event::acquire);
+
 		if (raddr && raddr != ch_mfc_cmd.eal)
 		{
 			ch_event_stat |= SPU_EVENT_LR;
@@ -742,6 +949,7 @@ void SPUThread::process_mfc_cmd()
 			_xend();
 
 			_ref<decltype(rdata)>(ch_mfc_cmd.lsa & 0x3ffff) = rdata;
+			on_ls_write(ch_mfc_cmd.lsa & 0x3ffff, 128);
 			return ch_atomic_stat.set_value(MFC_GETLLAR_SUCCESS);
 		}
 		else
@@ -761,6 +969,7 @@ void SPUThread::process_mfc_cmd()
 
 		// Copy to LS
 		_ref<decltype(rdata)>(ch_mfc_cmd.lsa & 0x3ffff) = rdata;
+		on_ls_write(ch_mfc_cmd.lsa & 0x3ffff, 128);
 
 		return ch_atomic_stat.set_value(MFC_GETLLAR_SUCCESS);
 	}
@@ -809,6 +1018,8 @@ void SPUThread::process_mfc_cmd()
 			}
 		}
 
+		vm::reservation_stat(ch_mfc_cmd.eal, id, result ? vm::reservation_event::success : vm::reservation_event::failure);
+
 		if (result)
 		{
 			ch_atomic_stat.set_value(MFC_PUTLLC_SUCCESS);
@@ -889,7 +1100,7 @@ void SPUThread::process_mfc_cmd()
 	case MFC_GETF_CMD:
 	{
 		// Try to process small transfers immediately
-		if (ch_mfc_cmd.size <= max_imm_dma_size && mfc_queue.size() == 0)
+		if (ch_mfc_cmd.size <= max_imm_dma_size && !is_ordered())
 		{
 			vm::reader_lock lock(vm::try_to_lock);
 
@@ -920,7 +1131,7 @@ void SPUThread::process_mfc_cmd()
 	case MFC_GETLB_CMD:
 	case MFC_GETLF_CMD:
 	{
-		if (ch_mfc_cmd.size <= max_imm_dma_size && mfc_queue.size() == 0)
+		if (ch_mfc_cmd.size <= max_imm_dma_size && !is_ordered())
 		{
 			vm::reader_lock lock(vm::try_to_lock);
 
@@ -938,6 +1149,8 @@ void SPUThread::process_mfc_cmd()
 
 			u32 total_size = 0;
 
+			spu_dma_list_batch batch(*this, ch_mfc_cmd);
+
 			while (ch_mfc_cmd.size && total_size <= max_imm_dma_size)
 			{
 				ch_mfc_cmd.lsa &= 0x3fff0;
@@ -973,7 +1186,7 @@ void SPUThread::process_mfc_cmd()
 					transfer.cmd = MFC(ch_mfc_cmd.cmd & ~MFC_LIST_MASK);
 					transfer.size = size;
 
-					do_dma_transfer(transfer);
+					batch.push(transfer);
 					const u32 add_size = std::max<u32>(size, 16);
 					ch_mfc_cmd.lsa += add_size;
 					total_size += add_size;
@@ -983,6 +1196,8 @@ void SPUThread::process_mfc_cmd()
 				ch_mfc_cmd.size -= 8;
 			}
 
+			batch.flush();
+
 			if (ch_mfc_cmd.size == 0)
 			{
 				return;
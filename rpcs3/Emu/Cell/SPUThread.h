@@ -537,6 +537,9 @@ public:
 	// MFC command queue (consumer: MFC thread)
 	lf_spsc<spu_mfc_cmd, 16> mfc_queue;
 
+	// Set when the SPU waits for a free MFC queue entry (reset and notified by MFC thread)
+	atomic_t<bool> mfc_queue_wait{false};
+
 	// MFC command proxy queue (consumer: MFC thread)
 	lf_mpsc<spu_mfc_cmd, 8> mfc_proxy;
 
@@ -591,11 +594,20 @@ public:
 	std::exception_ptr pending_exception;
 
 	std::array<struct spu_function_t*, 65536> compiled_cache{};
+	std::array<u32, 65536> compiled_stamp{}; // ls_stamp value at which compiled_cache entry was validated
+	atomic_t<u32> ls_stamp{1}; // Incremented when code in LS has been modified
+	std::array<atomic_t<u64>, 32> ls_code_lines{}; // Bitmap of 128-byte LS lines containing compiled code
+	std::array<atomic_t<u32>, 2048> ls_line_stamp{}; // ls_stamp value at the last modification of each code line
+	u32 call_link = -1; // Return address of the innermost compiled function call
 	std::shared_ptr<class SPUDatabase> spu_db;
 	std::shared_ptr<class spu_recompiler_base> spu_rec;
+	std::shared_ptr<class spu_compiler_pool> spu_pool;
 	u32 recursion_level = 0;
 
 	void push_snr(u32 number, u32 value);
+	void on_ls_write(u32 lsa, u32 size); // Must be called after writing LS (invalidates compiled_cache), may be called from other threads
+	void set_code_lines(u32 lsa, u32 size);
+	bool is_code_modified(u32 lsa, u32 size, u32 stamp) const;
 	void do_dma_transfer(const spu_mfc_cmd& args, bool from_mfc = true);
 
 	void process_mfc_cmd();
@@ -624,3 +636,23 @@ public:
 		return *_ptr<T>(lsa);
 	}
 };
+
+// Merges contiguous list DMA elements into larger transfers (flush() must be called when the list stops)
+class spu_dma_list_batch
+{
+	SPUThread& m_spu;
+	spu_mfc_cmd m_cmd{};
+	const u32 m_list_lsa; // LS range occupied by the list itself
+	const u32 m_list_end;
+
+public:
+	spu_dma_list_batch(SPUThread& spu, const spu_mfc_cmd& list)
+		: m_spu(spu)
+		, m_list_lsa(list.eal & 0x3fff8)
+		, m_list_end((list.eal & 0x3fff8) + list.size)
+	{
+	}
+
+	void push(const spu_mfc_cmd& transfer);
+	void flush();
+};
@@ -994,6 +994,102 @@ DECLARE(lv2_obj::g_ppu);
 DECLARE(lv2_obj::g_pending);
 DECLARE(lv2_obj::g_waiting);
 
+ppu_thread* lv2_ppu_queue::get_first(u32 prio) const
+{
+	// Find the first non-empty list starting from prio
+	u32 index = prio / 64;
+
+	if (index >= m_mask.size())
+	{
+		return nullptr;
+	}
+
+	if (const u64 bits = m_mask[index] & (~0ull << (prio % 64)))
+	{
+		return m_list[index * 64 + cnttz64(bits, true)].first;
+	}
+
+	if (const u64 top = index + 1 < 64 ? m_mask_top & (~0ull << (index + 1)) : 0)
+	{
+		index = static_cast<u32>(cnttz64(top, true));
+		return m_list[index * 64 + cnttz64(m_mask[index], true)].first;
+	}
+
+	return nullptr;
+}
+
+bool lv2_ppu_queue::push(ppu_thread* thread)
+{
+	if (thread->sched_prio != ~0u)
+	{
+		return false;
+	}
+
+	const u32 prio = std::min<u32>(thread->prio, 3071);
+	auto& list = m_list[prio];
+
+	thread->sched_prio = prio;
+	thread->sched_prev = list.second;
+	thread->sched_next = nullptr;
+
+	if (list.second)
+	{
+		list.second->sched_next = thread;
+	}
+	else
+	{
+		list.first = thread;
+		m_mask[prio / 64] |= 1ull << (prio % 64);
+		m_mask_top |= 1ull << (prio / 64);
+	}
+
+	list.second = thread;
+	return true;
+}
+
+bool lv2_ppu_queue::remove(ppu_thread* thread)
+{
+	const u32 prio = thread->sched_prio;
+
+	if (prio == ~0u)
+	{
+		return false;
+	}
+
+	auto& list = m_list[prio];
+
+	(thread->sched_prev ? thread->sched_prev->sched_next : list.first) = thread->sched_next;
+	(thread->sched_next ? thread->sched_next->sched_prev : list.second) = thread->sched_prev;
+
+	if (!list.first && !(m_mask[prio / 64] &= ~(1ull << (prio % 64))))
+	{
+		m_mask_top &= ~(1ull << (prio / 64));
+	}
+
+	thread->sched_prio = ~0u;
+	thread->sched_prev = nullptr;
+	thread->sched_next = nullptr;
+	return true;
+}
+
+ppu_thread* lv2_ppu_queue::front() const
+{
+	return get_first(0);
+}
+
+ppu_thread* lv2_ppu_queue::next(ppu_thread* thread) const
+{
+	return thread->sched_next ? thread->sched_next : get_first(thread->sched_prio + 1);
+}
+
+void lv2_ppu_queue::clear()
+{
+	while (const auto thread = front())
+	{
+		remove(thread);
+	}
+}
+
 void lv2_obj::sleep_timeout(named_thread& thread, u64 timeout)
 {
 	semaphore_lock lock(g_mutex);
@@ -1019,7 +1115,7 @@ void lv2_obj::sleep_timeout(named_thread& thread, u64 timeout)
 		}
 
 		// Find and remove the thread
-		unqueue(g_ppu, ppu);
+		g_ppu.remove(ppu);
 		unqueue(g_pending, ppu);
 
 		ppu->start_time = start_time;
@@ -1050,66 +1146,52 @@ void lv2_obj::awake(cpu_thread& cpu, u32 prio)
 	// Check thread type
 	if (cpu.id_type() != 1) return;
 
+	auto& ppu = static_cast<ppu_thread&>(cpu);
+
 	semaphore_lock lock(g_mutex);
 
 	if (prio == -4)
 	{
-		// Yield command
+		// Yield command: requeue at the end of the FIFO of the priority the thread was queued with
 		const u64 start_time = get_system_time();
 
-		for (std::size_t i = 0, pos = -1; i < g_ppu.size(); i++)
+		if (ppu.sched_prio != ~0u && !ppu.sched_next && g_ppu.next(&ppu))
 		{
-			if (g_ppu[i] == &cpu)
-			{
-				pos = i;
-				prio = g_ppu[i]->prio;
-			}
-			else if (i == pos + 1 && prio != -4 && g_ppu[i]->prio != prio)
-			{
-				return;
-			}
+			// Followed by a thread with another priority
+			return;
 		}
 
-		unqueue(g_ppu, &cpu);
+		g_ppu.remove(&ppu);
 		unqueue(g_pending, &cpu);
 
-		static_cast<ppu_thread&>(cpu).start_time = start_time;
+		ppu.start_time = start_time;
 	}
 
-	if (prio < INT32_MAX && !unqueue(g_ppu, &cpu))
+	if (prio < INT32_MAX && !g_ppu.remove(&ppu))
 	{
 		// Priority set
 		return;
 	}
 
-	// Emplace current thread
-	for (std::size_t i = 0; i <= g_ppu.size(); i++)
+	// Emplace current thread (use priority, also preserve FIFO order)
+	if (g_ppu.push(&ppu))
 	{
-		if (i < g_ppu.size() && g_ppu[i] == &cpu)
-		{
-			LOG_TRACE(PPU, "sleep() - suspended (p=%zu)", g_pending.size());
-			break;
-		}
+		LOG_TRACE(PPU, "awake(): %s", cpu.id);
 
-		// Use priority, also preserve FIFO order
-		if (i == g_ppu.size() || g_ppu[i]->prio > static_cast<ppu_thread&>(cpu).prio)
+		// Unregister timeout if necessary
+		for (auto it = g_waiting.cbegin(), end = g_waiting.cend(); it != end; it++)
 		{
-			LOG_TRACE(PPU, "awake(): %s", cpu.id);
-			g_ppu.insert(g_ppu.cbegin() + i, &static_cast<ppu_thread&>(cpu));
-
-			// Unregister timeout if necessary
-			for (auto it = g_waiting.cbegin(), end = g_waiting.cend(); it != end; it++)
+			if (it->second == &cpu)
 			{
-				if (it->second == &cpu)
-				{
-					g_waiting.erase(it);
-					break;
-				}
+				g_waiting.erase(it);
+				break;
 			}
-
-			break;
 		}
 	}
+	else
+	{
+		LOG_TRACE(PPU, "sleep() - suspended (p=%zu)", g_pending.size());
+	}
 
 	// Remove pending if necessary
 	if (!g_pending.empty() && cpu.get() == thread_ctrl::get_current())
@@ -1118,10 +1200,15 @@ void lv2_obj::awake(cpu_thread& cpu, u32 prio)
 	}
 
 	// Suspend threads if necessary
-	for (std::size_t i = g_cfg.core.ppu_threads; i < g_ppu.size(); i++)
+	auto target = g_ppu.front();
+
+	for (u32 i = 0; target && i < static_cast<u32>(g_cfg.core.ppu_threads); i++)
 	{
-		const auto target = g_ppu[i];
+		target = g_ppu.next(target);
+	}
 
+	for (; target; target = g_ppu.next(target))
+	{
 		if (!target->state.test_and_set(cpu_flag::suspend))
 		{
 			LOG_TRACE(PPU, "suspend(): %s", target->id);
@@ -1144,10 +1231,10 @@ void lv2_obj::schedule_all()
 	if (g_pending.empty())
 	{
 		// Wake up threads
-		for (std::size_t i = 0, x = std::min<std::size_t>(g_cfg.core.ppu_threads, g_ppu.size()); i < x; i++)
-		{
-			const auto target = g_ppu[i];
+		auto target = g_ppu.front();
 
+		for (u32 i = 0; target && i < static_cast<u32>(g_cfg.core.ppu_threads); i++, target = g_ppu.next(target))
+		{
 			if (test(target->state, cpu_flag::suspend))
 			{
 				LOG_TRACE(PPU, "schedule(): %s", target->id);
@@ -2,11 +2,15 @@
 #include "sys_fs.h"
 
 #include <mutex>
+#include <condition_variable>
+#include <thread>
 
 #include "Emu/Cell/PPUThread.h"
 #include "Crypto/unedat.h"
+#include "Emu/System.h"
 #include "Emu/VFS.h"
 #include "Emu/IdManager.h"
+#include "Emu/RSX/GSRender.h"
 #include "Utilities/StrUtil.h"
 
 
@@ -25,6 +29,12 @@ lv2_fs_mount_point g_mp_sys_dev_bdvd;
 lv2_fs_mount_point g_mp_sys_app_home;
 lv2_fs_mount_point g_mp_sys_host_root;
 
+// Size of the intermediate buffer for file I/O
+static constexpr u64 s_fs_buffer_size = 0x40000;
+
+// Max size of a single native call for direct file I/O
+static constexpr u64 s_fs_direct_block = 0x10000000;
+
 bool verify_mself(u32 fd, fs::file const& mself_file)
 {
 	FsMselfHeader mself_header;
@@ -64,21 +74,139 @@ lv2_fs_mount_point* lv2_fs_object::get_mp(const char* filename)
 	return &g_mp_sys_dev_hdd0;
 }
 
+// Intermediate buffer for file I/O, reused by each thread (avoid passing vm pointer to a native API)
+static u8* get_fs_buffer()
+{
+	thread_local const std::unique_ptr<u8[]> s_buffer(new u8[s_fs_buffer_size]);
+	return s_buffer.get();
+}
+
+// Check whether guest memory is worth passing to a native API (mapped and not protected by the RSX cache)
+// The result may be stale, so a failed direct access must be redone with the intermediate buffer
+static bool is_fs_direct_io(u32 addr, u64 size, bool is_writing)
+{
+	if (size == 0 || size >= 0x100000000 - addr)
+	{
+		return false;
+	}
+
+	if (!vm::check_addr(addr, static_cast<u32>(size), is_writing ? vm::page_writable : vm::page_readable))
+	{
+		return false;
+	}
+
+	if (const auto rsxthr = fxm::get<GSRender>())
+	{
+		return !rsxthr->is_memory_protected(addr, static_cast<u32>(size), is_writing);
+	}
+
+	return true;
+}
+
 u64 lv2_file::op_read(vm::ptr<void> buf, u64 size)
 {
-	// Copy data from intermediate buffer (avoid passing vm pointer to a native API)
-	std::unique_ptr<u8[]> local_buf(new u8[size]);
-	const u64 result = file.read(local_buf.get(), size);
-	std::memcpy(buf.get_ptr(), local_buf.get(), result);
+	const auto dst = static_cast<u8*>(buf.get_ptr());
+
+	u64 result = 0;
+
+	if (is_fs_direct_io(buf.addr(), size, true))
+	{
+		// Read directly into guest memory
+		while (result < size)
+		{
+			const u64 block = std::min<u64>(size - result, s_fs_direct_block);
+			u64 nread;
+
+			try
+			{
+				nread = file.read(dst + result, block);
+			}
+			catch (const std::exception&)
+			{
+				// The range could have been protected meanwhile, retry the block below
+				break;
+			}
+
+			result += nread;
+
+			if (nread < block)
+			{
+				// End of file or partial access, the rest is handled below
+				break;
+			}
+		}
+	}
+
+	// Copy data from intermediate buffer in blocks
+	const auto local_buf = get_fs_buffer();
+
+	while (result < size)
+	{
+		const u64 block = std::min<u64>(size - result, s_fs_buffer_size);
+		const u64 nread = file.read(local_buf, block);
+		std::memcpy(dst + result, local_buf, nread);
+		result += nread;
+
+		if (nread < block)
+		{
+			break;
+		}
+	}
+
 	return result;
 }
 
 u64 lv2_file::op_write(vm::cptr<void> buf, u64 size)
 {
-	// Copy data to intermediate buffer (avoid passing vm pointer to a native API)
-	std::unique_ptr<u8[]> local_buf(new u8[size]);
-	std::memcpy(local_buf.get(), buf.get_ptr(), size);
-	return file.write(local_buf.get(), size);
+	const auto src = static_cast<const u8*>(buf.get_ptr());
+
+	u64 result = 0;
+
+	if (is_fs_direct_io(buf.addr(), size, false))
+	{
+		// Write directly from guest memory
+		while (result < size)
+		{
+			const u64 block = std::min<u64>(size - result, s_fs_direct_block);
+			u64 nwritten;
+
+			try
+			{
+				nwritten = file.write(src + result, block);
+			}
+			catch (const std::exception&)
+			{
+				// The range could have been protected meanwhile, retry the block below
+				break;
+			}
+
+			result += nwritten;
+
+			if (nwritten < block)
+			{
+				// Partial access, the rest is handled below
+				break;
+			}
+		}
+	}
+
+	// Copy data to intermediate buffer in blocks
+	const auto local_buf = get_fs_buffer();
+
+	while (result < size)
+	{
+		const u64 block = std::min<u64>(size - result, s_fs_buffer_size);
+		std::memcpy(local_buf, src + result, block);
+		const u64 nwritten = file.write(local_buf, block);
+		result += nwritten;
+
+		if (nwritten < block)
+		{
+			break;
+		}
+	}
+
+	return result;
 }
 
 struct lv2_file::file_view : fs::file_base
@@ -148,6 +276,264 @@ struct lv2_file::file_view : fs::file_base
 	}
 };
 
+// Worker pool servicing read-ahead requests of all open files
+struct lv2_fs_read_ahead_pool
+{
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::deque<lv2_file::read_ahead*> m_queue;
+	std::vector<std::shared_ptr<thread_ctrl>> m_workers;
+	bool m_exit = false;
+
+	lv2_fs_read_ahead_pool();
+	~lv2_fs_read_ahead_pool();
+
+	// Queue the request of the file
+	void push(lv2_file::read_ahead* file);
+
+	// Remove the request if it's not started yet
+	bool cancel(lv2_file::read_ahead* file);
+};
+
+struct lv2_file::read_ahead : fs::file_base
+{
+	fs::file m_file;
+	u64 m_pos = 0;
+	u64 m_last_end = -1; // End of the last read (to detect sequential access)
+
+	std::mutex m_mutex;
+	std::condition_variable m_done; // Signals the end of the request
+
+	std::vector<u8> m_buf; // Prefetched data
+	std::vector<u8> m_spare; // Unused buffer (to avoid allocations)
+	u64 m_buf_pos = 0; // File position of the prefetched data
+	u64 m_req_pos = 0;
+	u64 m_req_size = 0;
+	bool m_pending = false; // The pool owns m_file while it's set
+
+	std::shared_ptr<lv2_fs_read_ahead_pool> m_pool;
+
+	explicit read_ahead(fs::file&& file)
+		: m_file(std::move(file))
+	{
+	}
+
+	~read_ahead() override
+	{
+		const bool cancelled = m_pool && m_pool->cancel(this);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (cancelled)
+		{
+			m_pending = false;
+		}
+
+		wait(lock);
+	}
+
+	// Wait for the pool to finish the current request
+	void wait(std::unique_lock<std::mutex>& lock)
+	{
+		while (m_pending)
+		{
+			m_done.wait(lock);
+		}
+	}
+
+	// Execute the request (called by the pool)
+	void process()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		std::vector<u8> data = std::move(m_spare);
+		data.resize(m_req_size);
+
+		const u64 pos = m_req_pos;
+
+		lock.unlock();
+		m_file.seek(pos);
+		data.resize(m_file.read(data.data(), data.size()));
+		lock.lock();
+
+		m_spare = std::move(m_buf);
+		m_buf = std::move(data);
+		m_buf_pos = pos;
+		m_pending = false;
+		m_done.notify_all();
+	}
+
+	fs::stat_t stat() override
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		wait(lock);
+		return m_file.stat();
+	}
+
+	bool trunc(u64 length) override
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		wait(lock);
+		m_buf.clear();
+		return m_file.trunc(length);
+	}
+
+	u64 read(void* buffer, u64 size) override
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		wait(lock);
+
+		u64 result = 0;
+
+		// Copy prefetched data
+		if (m_pos >= m_buf_pos && m_pos < m_buf_pos + m_buf.size())
+		{
+			result = std::min<u64>(size, m_buf_pos + m_buf.size() - m_pos);
+			std::memcpy(buffer, m_buf.data() + (m_pos - m_buf_pos), result);
+		}
+
+		// Read the rest synchronously
+		if (result < size)
+		{
+			m_file.seek(m_pos + result);
+			result += m_file.read(static_cast<u8*>(buffer) + result, size - result);
+		}
+
+		const bool is_sequential = m_pos == m_last_end;
+
+		m_pos += result;
+		m_last_end = m_pos;
+
+		// Prefetch next data if the file is read sequentially and the prefetched data is exhausted
+		if (is_sequential && result == size && m_pos >= m_buf_pos + m_buf.size())
+		{
+			if (!m_pool)
+			{
+				m_pool = fxm::get_always<lv2_fs_read_ahead_pool>();
+			}
+
+			m_req_pos = m_pos;
+			m_req_size = std::min<u64>(std::max<u64>(size * 4, 0x40000), 0x800000);
+			m_pending = true;
+			m_pool->push(this);
+		}
+
+		return result;
+	}
+
+	u64 write(const void* buffer, u64 size) override
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		wait(lock);
+		m_buf.clear();
+		m_file.seek(m_pos);
+
+		const u64 result = m_file.write(buffer, size);
+		m_pos += result;
+		return result;
+	}
+
+	u64 seek(s64 offset, fs::seek_mode whence) override
+	{
+		const s64 new_pos =
+			whence == fs::seek_set ? offset :
+			whence == fs::seek_cur ? offset + m_pos :
+			whence == fs::seek_end ? offset + size() :
+			(fmt::raw_error("lv2_file::read_ahead::seek(): invalid whence"), 0);
+
+		if (new_pos < 0)
+		{
+			fs::g_tls_error = fs::error::inval;
+			return -1;
+		}
+
+		m_pos = new_pos;
+		return m_pos;
+	}
+
+	u64 size() override
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		wait(lock);
+		return m_file.size();
+	}
+};
+
+lv2_fs_read_ahead_pool::lv2_fs_read_ahead_pool()
+{
+	const u32 thread_count = std::min<u32>(std::max<u32>(std::thread::hardware_concurrency() / 4, 1), 4);
+
+	for (u32 i = 0; i < thread_count; i++)
+	{
+		m_workers.emplace_back();
+
+		thread_ctrl::spawn(m_workers.back(), fmt::format("FS Read-Ahead %u", i), [this]()
+		{
+			while (true)
+			{
+				lv2_file::read_ahead* file;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+
+					m_cond.wait(lock, [&] { return m_exit || !m_queue.empty(); });
+
+					if (m_exit)
+					{
+						return;
+					}
+
+					file = m_queue.front();
+					m_queue.pop_front();
+				}
+
+				// The file can't be destroyed before the request is finished
+				file->process();
+			}
+		});
+	}
+}
+
+lv2_fs_read_ahead_pool::~lv2_fs_read_ahead_pool()
+{
+	// Files hold a reference to the pool, so no request can be pending here
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exit = true;
+	}
+
+	m_cond.notify_all();
+
+	for (auto& worker : m_workers)
+	{
+		worker->join();
+	}
+}
+
+void lv2_fs_read_ahead_pool::push(lv2_file::read_ahead* file)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.emplace_back(file);
+	}
+
+	m_cond.notify_one();
+}
+
+bool lv2_fs_read_ahead_pool::cancel(lv2_file::read_ahead* file)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const auto found = std::find(m_queue.begin(), m_queue.end(), file);
+
+	if (found == m_queue.end())
+	{
+		return false;
+	}
+
+	m_queue.erase(found);
+	return true;
+}
+
 fs::file lv2_file::make_view(const std::shared_ptr<lv2_file>& _file, u64 offset)
 {
 	fs::file result;
@@ -345,6 +731,14 @@ error_code sys_fs_open(vm::cptr<char> path, s32 flags, vm::ptr<u32> fd, s32 mode
 		}
 	}
 
+	if (g_cfg.vfs.read_ahead && (flags & CELL_FS_O_ACCMODE) == CELL_FS_O_RDONLY)
+	{
+		// Read-only files can be prefetched safely
+		fs::file stream;
+		stream.reset(std::make_unique<lv2_file::read_ahead>(std::move(file)));
+		file = std::move(stream);
+	}
+
 	if (const u32 id = idm::make<lv2_fs_object, lv2_file>(path.get_ptr(), std::move(file), mode, flags))
 	{
 		*fd = id;
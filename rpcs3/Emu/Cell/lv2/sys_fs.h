@@ -186,15 +186,18 @@ struct lv2_file final : lv2_fs_object
 	{
 	}
 
-	// File reading with intermediate buffer
+	// File reading (directly into guest memory if possible)
 	u64 op_read(vm::ptr<void> buf, u64 size);
 
-	// File writing with intermediate buffer
+	// File writing (directly from guest memory if possible)
 	u64 op_write(vm::cptr<void> buf, u64 size);
 
 	// For MSELF support
 	struct file_view;
 
+	// Asynchronous read-ahead for sequentially read files
+	struct read_ahead;
+
 	// Make file view from lv2_file object (for MSELF support)
 	static fs::file make_view(const std::shared_ptr<lv2_file>& _file, u64 offset);
 };
@@ -55,6 +55,31 @@ enum
 	SYS_SYNC_ATTR_ADAPTIVE_MASK  = 0xf000,
 };
 
+// Run queue of PPU threads: FIFO list per priority and a bitmap of non-empty lists
+class lv2_ppu_queue
+{
+	std::array<std::pair<class ppu_thread*, class ppu_thread*>, 3072> m_list{}; // First and last thread
+	std::array<u64, 3072 / 64> m_mask{}; // Non-empty lists
+	u64 m_mask_top{}; // Non-empty elements of m_mask
+
+	class ppu_thread* get_first(u32 prio) const;
+
+public:
+	// Add the thread to the end of its priority list (read once, see ppu_thread::sched_prio), returns false if already queued
+	bool push(class ppu_thread* thread);
+
+	// Returns false if not queued
+	bool remove(class ppu_thread* thread);
+
+	// Get the first thread in scheduling order
+	class ppu_thread* front() const;
+
+	// Get the next thread in scheduling order
+	class ppu_thread* next(class ppu_thread* thread) const;
+
+	void clear();
+};
+
 // Base class for some kernel objects (shared set of 8192 objects).
 struct lv2_obj
 {
@@ -212,7 +237,7 @@ private:
 	static semaphore<> g_mutex;
 
 	// Scheduler queue for active PPU threads
-	static std::deque<class ppu_thread*> g_ppu;
+	static lv2_ppu_queue g_ppu;
 
 	// Waiting for the response from
 	static std::deque<class cpu_thread*> g_pending;
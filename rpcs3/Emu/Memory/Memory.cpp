@@ -39,6 +39,7 @@ u32 VirtualMemoryBlock::Map(u32 realaddr, u32 size)
 		if (!is_good_addr) continue;
 
 		m_mapped_memory.emplace_back(addr, realaddr, size);
+		UpdateIOTable();
 
 		return addr;
 	}
@@ -67,6 +68,7 @@ bool VirtualMemoryBlock::Map(u32 realaddr, u32 size, u32 addr)
 	}
 
 	m_mapped_memory.emplace_back(addr, realaddr, size);
+	UpdateIOTable();
 	return true;
 }
 
@@ -78,6 +80,7 @@ bool VirtualMemoryBlock::UnmapRealAddress(u32 realaddr, u32& size)
 		{
 			size = m_mapped_memory[i].size;
 			m_mapped_memory.erase(m_mapped_memory.begin() + i);
+			UpdateIOTable();
 			return true;
 		}
 	}
@@ -93,6 +96,7 @@ bool VirtualMemoryBlock::UnmapAddress(u32 addr, u32& size)
 		{
 			size = m_mapped_memory[i].size;
 			m_mapped_memory.erase(m_mapped_memory.begin() + i);
+			UpdateIOTable();
 			return true;
 		}
 	}
@@ -120,6 +124,17 @@ bool VirtualMemoryBlock::Write32(const u32 addr, const u32 value)
 
 bool VirtualMemoryBlock::getRealAddr(u32 addr, u32& result)
 {
+	if (addr < m_io_table.size() * 0x100000)
+	{
+		const u32 page = m_io_table[addr >> 20];
+
+		if (page != io_table_unmapped)
+		{
+			result = page + (addr & 0xfffff);
+			return true;
+		}
+	}
+
 	for (u32 i = 0; i<m_mapped_memory.size(); ++i)
 	{
 		if (addr >= m_mapped_memory[i].addr && addr < m_mapped_memory[i].addr + m_mapped_memory[i].size)
@@ -132,6 +147,30 @@ bool VirtualMemoryBlock::getRealAddr(u32 addr, u32& result)
 	return false;
 }
 
+void VirtualMemoryBlock::UpdateIOTable()
+{
+	for (u32 i = 0; i < m_io_table.size(); i++)
+	{
+		const u32 addr = i << 20;
+
+		m_io_table[i] = io_table_unmapped;
+
+		// The first mapping touching the page is the one getRealAddr would find, use it only if it covers the whole page
+		for (const auto& info : m_mapped_memory)
+		{
+			if (addr + 0x100000 > info.addr && addr < info.addr + info.size)
+			{
+				if (addr >= info.addr && addr + 0x100000 <= info.addr + info.size)
+				{
+					m_io_table[i] = info.realAddress + (addr - info.addr);
+				}
+
+				break;
+			}
+		}
+	}
+}
+
 u32 VirtualMemoryBlock::getMappedAddress(u32 realAddress)
 {
 	for (u32 i = 0; i<m_mapped_memory.size(); ++i)
@@ -42,11 +42,22 @@ class VirtualMemoryBlock
 	u32 m_range_start = 0;
 	u32 m_range_size = 0;
 
+	// Value of unmapped m_io_table entries
+	static const u32 io_table_unmapped = ~0u;
+
+	// Real address of every 1 MB page covered by a single mapping (io_table_unmapped if none), rebuilt on map/unmap
+	std::array<u32, 0x200> m_io_table;
+
+	void UpdateIOTable();
+
 public:
-	VirtualMemoryBlock() = default;
+	VirtualMemoryBlock()
+	{
+		m_io_table.fill(io_table_unmapped);
+	}
 
 	VirtualMemoryBlock* SetRange(const u32 start, const u32 size);
-	void Clear() { m_mapped_memory.clear(); m_reserve_size = 0; m_range_start = 0; m_range_size = 0; }
+	void Clear() { m_mapped_memory.clear(); m_io_table.fill(io_table_unmapped); m_reserve_size = 0; m_range_start = 0; m_range_size = 0; }
 	u32 GetStartAddr() const { return m_range_start; }
 	u32 GetSize() const { return m_range_size; }
 	bool IsInMyRange(const u32 addr, const u32 size);
@@ -3,13 +3,13 @@
 #include "Emu/System.h"
 #include "Utilities/mutex.h"
 #include "Utilities/Thread.h"
+#include "Utilities/sysinfo.h"
 #include "Utilities/VirtualMemory.h"
 #include "Emu/CPU/CPUThread.h"
 #include "Emu/Cell/lv2/sys_memory.h"
 #include "Emu/RSX/GSRender.h"
 
 #include <atomic>
-#include <deque>
 
 namespace vm
 {
@@ -42,8 +42,31 @@ namespace vm
 	// Reservations (lock lines) in a single memory page
 	using reservation_info = std::array<std::atomic<u64>, 4096 / 128>;
 
-	// Registered waiters
-	std::deque<vm::waiter*> g_waiters;
+	// Registered waiters for a subset of reservation lines
+	struct waiter_bucket
+	{
+		// Only taken by non-transactional notifiers and by unregistration (as a grace period)
+		shared_mutex mutex;
+
+		// Fixed slots, scanned without locking (may be called inside of a transaction)
+		std::array<atomic_t<const vm::waiter*>, 32> slots{};
+
+		// Waiters which didn't get a slot (protected by the mutex)
+		std::vector<const vm::waiter*> overflow;
+
+		// Size of the overflow list (notifying inside of a transaction is aborted if not zero)
+		atomic_t<u32> overflow_count{0};
+	};
+
+	static const bool s_use_rtm = utils::has_rtm();
+
+	// Registered waiters (indexed by reservation line)
+	std::array<waiter_bucket, 64> g_waiters;
+
+	static waiter_bucket& get_waiters(u32 addr)
+	{
+		return g_waiters[(addr / 128) % g_waiters.size()];
+	}
 
 	// Memory mutex core
 	shared_mutex g_mutex;
@@ -256,12 +279,119 @@ namespace vm
 		(*g_pages[addr >> 12].reservations)[(addr & 0xfff) >> 7].store(__rdtsc(), std::memory_order_release);
 	}
 
+	// Reservation statistics of a 128-byte line
+	struct reservation_stat_t
+	{
+		atomic_t<u32> line; // Line address | 1 (0 if unused)
+		atomic_t<u32> last_success; // ID of the last thread which succeeded
+		atomic_t<u32> last_failure; // ID of the last thread which failed
+		atomic_t<u64> acquired;
+		atomic_t<u64> succeeded;
+		atomic_t<u64> failed;
+	};
+
+	// Reservation statistics table (hashed by line address, allocated only when enabled)
+	std::unique_ptr<std::array<reservation_stat_t, 0x10000>> g_rstats;
+
+	void reservation_stat(u32 addr, u32 id, reservation_event event)
+	{
+		if (LIKELY(!g_rstats))
+		{
+			return;
+		}
+
+		const u32 line = (addr & -128) | 1;
+		const u32 hash = (addr / 128) * 0x9e3779b1 >> 16;
+
+		// Short linear probing, events are dropped if no entry is available
+		for (u32 i = 0; i < 8; i++)
+		{
+			auto& stat = (*g_rstats)[(hash + i) % g_rstats->size()];
+
+			if (const u32 old = stat.line.compare_and_swap(0, line))
+			{
+				if (old != line)
+				{
+					continue;
+				}
+			}
+
+			switch (event)
+			{
+			case reservation_event::acquire:
+			{
+				stat.acquired++;
+				break;
+			}
+			case reservation_event::success:
+			{
+				stat.succeeded++;
+				stat.last_success = id;
+				break;
+			}
+			case reservation_event::failure:
+			{
+				stat.failed++;
+				stat.last_failure = id;
+				break;
+			}
+			}
+
+			return;
+		}
+	}
+
+	static void reservation_stat_dump()
+	{
+		std::vector<const reservation_stat_t*> lines;
+
+		for (const auto& stat : *g_rstats)
+		{
+			if (stat.line)
+			{
+				lines.emplace_back(&stat);
+			}
+		}
+
+		// Most contended lines first
+		const auto count = std::min<std::size_t>(lines.size(), 32);
+
+		std::partial_sort(lines.begin(), lines.begin() + count, lines.end(), [](const reservation_stat_t* a, const reservation_stat_t* b)
+		{
+			return a->failed != b->failed ? a->failed > b->failed : a->acquired > b->acquired;
+		});
+
+		LOG_NOTICE(MEMORY, "Reservation statistics (%zu lines):", lines.size());
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			const auto& stat = *lines[i];
+
+			LOG_NOTICE(MEMORY, "0x%08x: acquired=%llu, succeeded=%llu, failed=%llu (last success: 0x%x, last failure: 0x%x)",
+				stat.line.load() & -128, stat.acquired.load(), stat.succeeded.load(), stat.failed.load(), stat.last_success.load(), stat.last_failure.load());
+		}
+	}
+
 	void waiter::init()
 	{
 		// Register waiter
-		writer_lock lock(0);
+		auto& bucket = get_waiters(addr);
 
-		g_waiters.emplace_back(this);
+		for (auto& slot : bucket.slots)
+		{
+			if (slot.compare_and_swap_test(nullptr, this))
+			{
+				registered = true;
+				return;
+			}
+		}
+
+		// All slots are taken
+		::writer_lock lock(bucket.mutex);
+
+		bucket.overflow.emplace_back(this);
+		bucket.overflow_count++;
+		registered = true;
 	}
 
 	void waiter::test() const
@@ -291,34 +421,94 @@ namespace vm
 
 	waiter::~waiter()
 	{
+		if (!registered)
+		{
+			return;
+		}
+
 		// Unregister waiter
-		writer_lock lock(0);
+		auto& bucket = get_waiters(addr);
 
-		// Find waiter
-		const auto found = std::find(g_waiters.cbegin(), g_waiters.cend(), this);
+		for (auto& slot : bucket.slots)
+		{
+			if (slot.compare_and_swap_test(this, nullptr))
+			{
+				// Wait for non-transactional notifiers which could still access this waiter
+				// (a transaction which has read the slot is aborted by the store above)
+				::writer_lock lock(bucket.mutex);
+				return;
+			}
+		}
+
+		::writer_lock lock(bucket.mutex);
+
+		// Not found in the slots: remove from the overflow list
+		const auto found = std::find(bucket.overflow.cbegin(), bucket.overflow.cend(), this);
 
-		if (found != g_waiters.cend())
+		if (found != bucket.overflow.cend())
 		{
-			g_waiters.erase(found);
+			// Order is irrelevant
+			bucket.overflow[found - bucket.overflow.cbegin()] = bucket.overflow.back();
+			bucket.overflow.pop_back();
+			bucket.overflow_count--;
 		}
 	}
 
-	void notify(u32 addr, u32 size)
+	static void notify_bucket(waiter_bucket& bucket, u32 addr, bool all)
+	{
+		for (auto& slot : bucket.slots)
+		{
+			if (const waiter* ptr = slot.load())
+			{
+				if (all || ptr->addr / 128 == addr / 128)
+				{
+					ptr->test();
+				}
+			}
+		}
+	}
+
+	static void notify_overflow(waiter_bucket& bucket, u32 addr, bool all)
 	{
-		for (const waiter* ptr : g_waiters)
+		for (const waiter* ptr : bucket.overflow)
 		{
-			if (ptr->addr / 128 == addr / 128)
+			if (all || ptr->addr / 128 == addr / 128)
 			{
 				ptr->test();
 			}
 		}
 	}
 
+	void notify(u32 addr, u32 size)
+	{
+		auto& bucket = get_waiters(addr);
+
+		if (s_use_rtm && _xtest())
+		{
+			// The overflow list can't be read safely without the lock
+			if (bucket.overflow_count)
+			{
+				_xabort(0);
+			}
+
+			// Don't touch the lock word inside of a transaction
+			return notify_bucket(bucket, addr, false);
+		}
+
+		::reader_lock lock(bucket.mutex);
+
+		notify_bucket(bucket, addr, false);
+		notify_overflow(bucket, addr, false);
+	}
+
 	void notify_all()
 	{
-		for (const waiter* ptr : g_waiters)
+		for (auto& bucket : g_waiters)
 		{
-			ptr->test();
+			::reader_lock lock(bucket.mutex);
+
+			notify_bucket(bucket, 0, true);
+			notify_overflow(bucket, 0, true);
 		}
 	}
 
@@ -795,11 +985,22 @@ namespace vm
 				std::make_shared<block_t>(0x40000000, 0x10000000), // rsx contexts
 				std::make_shared<block_t>(0x30000000, 0x10000000), // main extend
 			};
+
+			if (g_cfg.core.reservation_stats)
+			{
+				g_rstats = std::make_unique<std::array<reservation_stat_t, 0x10000>>();
+			}
 		}
 	}
 
 	void close()
 	{
+		if (g_rstats)
+		{
+			reservation_stat_dump();
+			g_rstats.reset();
+		}
+
 		g_locations.clear();
 
 		utils::memory_decommit(g_base_addr, 0x100000000);
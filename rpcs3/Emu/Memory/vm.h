@@ -40,11 +40,12 @@ namespace vm
 
 	struct waiter
 	{
-		named_thread* owner;
-		u32 addr;
-		u32 size;
-		u64 stamp;
-		const void* data;
+		named_thread* owner = nullptr;
+		u32 addr = 0;
+		u32 size = 0;
+		u64 stamp = 0;
+		const void* data = nullptr;
+		bool registered = false; // Set by init()
 
 		waiter() = default;
 
@@ -106,6 +107,16 @@ namespace vm
 	// End atomic update
 	void reservation_update(u32 addr, u32 size);
 
+	enum class reservation_event : u32
+	{
+		acquire,
+		success,
+		failure,
+	};
+
+	// Record reservation event of the thread (if statistics are enabled)
+	void reservation_stat(u32 addr, u32 id, reservation_event event);
+
 	// Check and notify memory changes at address
 	void notify(u32 addr, u32 size);
 
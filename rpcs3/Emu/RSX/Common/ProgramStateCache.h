@@ -7,6 +7,12 @@
 #include "Utilities/GSL.h"
 #include "Utilities/hash.h"
 
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <unordered_set>
+
 enum class SHADER_TYPE
 {
 	SHADER_TYPE_VERTEX,
@@ -119,6 +125,14 @@ class program_state_cache
 		}
 	};
 
+	struct pipeline_build_job
+	{
+		pipeline_key key;
+		std::function<pipeline_storage_type()> build;
+	};
+
+	static constexpr u32 max_pipeline_builds_per_frame = 16;
+
 protected:
 	size_t m_next_id = 0;
 	bool m_cache_miss_flag;
@@ -126,6 +140,98 @@ protected:
 	binary_to_fragment_program m_fragment_shader_cache;
 	std::unordered_map <pipeline_key, pipeline_storage_type, pipeline_key_hash, pipeline_key_compare> m_storage;
 
+	// Asynchronous pipeline builds (m_storage is shared with the build threads and protected by m_pipeline_mutex)
+	std::mutex m_pipeline_mutex;
+	std::condition_variable m_build_cv;
+	std::condition_variable m_build_done_cv;
+	std::deque<pipeline_build_job> m_build_queue;
+	std::unordered_set<pipeline_key, pipeline_key_hash, pipeline_key_compare> m_pending_pipelines;
+	std::unordered_set<pipeline_key, pipeline_key_hash, pipeline_key_compare> m_failed_pipelines;
+	std::vector<std::thread> m_build_threads;
+	bool m_build_exit = false;
+
+	u32 m_frame_pipeline_builds = 0;
+	u32 m_frame_skipped_draws = 0;
+	u32 m_last_frame_pipeline_builds = 0;
+	u32 m_last_frame_skipped_draws = 0;
+
+	void pipeline_build_thread()
+	{
+		std::unique_lock<std::mutex> lock(m_pipeline_mutex);
+
+		while (true)
+		{
+			m_build_cv.wait(lock, [this]() { return m_build_exit || !m_build_queue.empty(); });
+
+			if (m_build_queue.empty())
+			{
+				return;
+			}
+
+			pipeline_build_job job = std::move(m_build_queue.front());
+			m_build_queue.pop_front();
+
+			lock.unlock();
+
+			pipeline_storage_type pipeline;
+			bool success = false;
+
+			try
+			{
+				pipeline = job.build();
+				success = true;
+			}
+			catch (const std::exception& e)
+			{
+				LOG_ERROR(RSX, "Pipeline build failed (vp id = %d, fp id = %d): %s", job.key.vertex_program_id, job.key.fragment_program_id, e.what());
+			}
+
+			lock.lock();
+
+			// A failed key is rebuilt on the renderer thread by the next draw using it (see getGraphicPipelineStateAsync)
+			if (success)
+			{
+				m_storage[job.key] = std::move(pipeline);
+			}
+			else
+			{
+				m_failed_pipelines.insert(job.key);
+			}
+
+			m_pending_pipelines.erase(job.key);
+
+			if (m_pending_pipelines.empty())
+			{
+				m_build_done_cv.notify_all();
+			}
+		}
+	}
+
+	// Must be called with m_pipeline_mutex held
+	template<typename... Args>
+	void queue_pipeline_build(const pipeline_key& key, const vertex_program_type& vertex_program, const fragment_program_type& fragment_program, const Args& ...args)
+	{
+		if (m_build_threads.empty())
+		{
+			const u32 thread_count = std::min(std::max(std::thread::hardware_concurrency(), 2u) / 2, 4u);
+
+			for (u32 i = 0; i < thread_count; i++)
+			{
+				m_build_threads.emplace_back(&program_state_cache::pipeline_build_thread, this);
+			}
+		}
+
+		LOG_NOTICE(RSX, "Queue program (vp id = %d, fp id = %d)", vertex_program.id, fragment_program.id);
+
+		m_pending_pipelines.insert(key);
+		m_build_queue.push_back({ key, [&vertex_program, &fragment_program, key, args...]()
+		{
+			return backend_traits::build_pipeline(vertex_program, fragment_program, key.properties, args...);
+		}});
+
+		m_build_cv.notify_one();
+	}
+
 	/// bool here to inform that the program was preexisting.
 	std::tuple<const vertex_program_type&, bool> search_vertex_program(const RSXVertexProgram& rsx_vp)
 	{
@@ -236,6 +342,19 @@ public:
 	program_state_cache() = default;
 	~program_state_cache()
 	{
+		wait_for_pipeline_builds();
+
+		{
+			std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+			m_build_exit = true;
+			m_build_cv.notify_all();
+		}
+
+		for (auto& thread : m_build_threads)
+		{
+			thread.join();
+		}
+
 		for (auto& pair : m_fragment_shader_cache)
 		{
 			free(pair.first.addr);
@@ -277,6 +396,8 @@ public:
 		backend_traits::validate_pipeline_properties(vertex_program, fragment_program, pipelineProperties);
 		pipeline_key key = { vertex_program.id, fragment_program.id, pipelineProperties };
 
+		std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+
 		if (already_existing_fragment_program && already_existing_vertex_program)
 		{
 			const auto I = m_storage.find(key);
@@ -298,6 +419,283 @@ public:
 		return m_storage[key];
 	}
 
+	/**
+	* Same as getGraphicPipelineState, but a missing pipeline is built on a worker thread and nullptr is returned until it is ready.
+	* Shaders are still compiled on the calling thread. Arguments are copied into the build job.
+	* At most max_pipeline_builds_per_frame builds are queued per frame (see on_frame_end).
+	* A pipeline which failed to build on a worker thread is built synchronously, so the error reaches the caller.
+	*/
+	template<typename... Args>
+	pipeline_storage_type* getGraphicPipelineStateAsync(
+		const RSXVertexProgram& vertexShader,
+		const RSXFragmentProgram& fragmentShader,
+		pipeline_properties& pipelineProperties,
+		Args&& ...args
+		)
+	{
+		const auto &vp_search = search_vertex_program(vertexShader);
+		const auto &fp_search = search_fragment_program(fragmentShader);
+		const vertex_program_type &vertex_program = std::get<0>(vp_search);
+		const fragment_program_type &fragment_program = std::get<0>(fp_search);
+
+		backend_traits::validate_pipeline_properties(vertex_program, fragment_program, pipelineProperties);
+		const pipeline_key key = { vertex_program.id, fragment_program.id, pipelineProperties };
+
+		m_cache_miss_flag = false;
+
+		std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+
+		const auto I = m_storage.find(key);
+		if (I != m_storage.end())
+		{
+			return &I->second;
+		}
+
+		if (m_failed_pipelines.count(key))
+		{
+			auto& pipeline = m_storage[key] = backend_traits::build_pipeline(vertex_program, fragment_program, pipelineProperties, std::forward<Args>(args)...);
+			m_failed_pipelines.erase(key);
+			m_cache_miss_flag = true;
+			return &pipeline;
+		}
+
+		m_frame_skipped_draws++;
+
+		if (m_pending_pipelines.count(key) || m_frame_pipeline_builds >= max_pipeline_builds_per_frame)
+		{
+			return nullptr;
+		}
+
+		queue_pipeline_build(key, vertex_program, fragment_program, args...);
+		m_frame_pipeline_builds++;
+		m_cache_miss_flag = true;
+		return nullptr;
+	}
+
+	/**
+	* Queue the pipeline build of a cached entry on the worker threads, without the per frame limit.
+	* Use get_pending_pipeline_count and wait_for_pipeline_builds to wait for the result.
+	*/
+	template<typename... Args>
+	void preloadGraphicPipelineState(
+		const RSXVertexProgram& vertexShader,
+		const RSXFragmentProgram& fragmentShader,
+		pipeline_properties& pipelineProperties,
+		Args&& ...args
+		)
+	{
+		const auto &vp_search = search_vertex_program(vertexShader);
+		const auto &fp_search = search_fragment_program(fragmentShader);
+		const vertex_program_type &vertex_program = std::get<0>(vp_search);
+		const fragment_program_type &fragment_program = std::get<0>(fp_search);
+
+		backend_traits::validate_pipeline_properties(vertex_program, fragment_program, pipelineProperties);
+		const pipeline_key key = { vertex_program.id, fragment_program.id, pipelineProperties };
+
+		std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+
+		if (m_storage.find(key) == m_storage.end() && m_pending_pipelines.count(key) == 0 && m_failed_pipelines.count(key) == 0)
+		{
+			queue_pipeline_build(key, vertex_program, fragment_program, args...);
+		}
+	}
+
+	/**
+	* Decompile and compile the shaders of a batch of cached programs. Programs already known are skipped.
+	* The work is spread over all cores when the backend compiler is not bound to a thread (backend_traits::parallel_shader_compile).
+	* on_progress(done, total) is called from the calling thread, returning false cancels the remaining programs.
+	* Entries of programs which were cancelled or failed to compile are removed before returning.
+	*/
+	void preload_programs(const std::vector<RSXVertexProgram>& vertex_programs, const std::vector<RSXFragmentProgram>& fragment_programs, const std::function<bool(u32, u32)>& on_progress)
+	{
+		std::vector<std::function<void()>> jobs;
+		std::vector<std::function<void()>> discards;
+
+		for (const auto& rsx_vp : vertex_programs)
+		{
+			if (m_vertex_shader_cache.find(rsx_vp) != m_vertex_shader_cache.end())
+				continue;
+
+			vertex_program_type& new_shader = m_vertex_shader_cache[rsx_vp];
+			const size_t id = m_next_id++;
+			jobs.emplace_back([&rsx_vp, &new_shader, id]() { backend_traits::recompile_vertex_program(rsx_vp, new_shader, id); });
+			discards.emplace_back([this, &rsx_vp]() { m_vertex_shader_cache.erase(rsx_vp); });
+		}
+
+		for (const auto& rsx_fp : fragment_programs)
+		{
+			if (m_fragment_shader_cache.find(rsx_fp) != m_fragment_shader_cache.end())
+				continue;
+
+			size_t fragment_program_size = program_hash_util::fragment_program_utils::get_fragment_program_ucode_size(rsx_fp.addr);
+			gsl::not_null<void*> fragment_program_ucode_copy = malloc(fragment_program_size);
+			std::memcpy(fragment_program_ucode_copy, rsx_fp.addr, fragment_program_size);
+			RSXFragmentProgram new_fp_key = rsx_fp;
+			new_fp_key.addr = fragment_program_ucode_copy;
+			fragment_program_type& new_shader = m_fragment_shader_cache[new_fp_key];
+			const size_t id = m_next_id++;
+			jobs.emplace_back([&rsx_fp, &new_shader, id]() { backend_traits::recompile_fragment_program(rsx_fp, new_shader, id); });
+			discards.emplace_back([this, &rsx_fp]()
+			{
+				const auto found = m_fragment_shader_cache.find(rsx_fp);
+				void* ucode = found->first.addr;
+				m_fragment_shader_cache.erase(found);
+				free(ucode);
+			});
+		}
+
+		const u32 total = ::size32(jobs);
+		if (!total)
+		{
+			return;
+		}
+
+		LOG_NOTICE(RSX, "Preloading %u shaders", total);
+
+		// Set by the thread which ran the job (distinct elements, read after the threads are joined)
+		std::vector<u8> finished(total, 0);
+
+		// search_*_program would take the default constructed entries of unfinished jobs as compiled programs
+		auto discard_unfinished = [&]()
+		{
+			for (u32 i = 0; i < total; i++)
+			{
+				if (!finished[i])
+				{
+					discards[i]();
+				}
+			}
+		};
+
+		if (!backend_traits::parallel_shader_compile)
+		{
+			for (u32 i = 0; i < total; i++)
+			{
+				try
+				{
+					jobs[i]();
+				}
+				catch (...)
+				{
+					discard_unfinished();
+					throw;
+				}
+
+				finished[i] = 1;
+
+				if (!on_progress(i + 1, total))
+				{
+					break;
+				}
+			}
+
+			discard_unfinished();
+			return;
+		}
+
+		const u32 thread_count = std::min(std::max(std::thread::hardware_concurrency(), 1u), total);
+
+		atomic_t<u32> next{ 0 };
+		atomic_t<u32> done{ 0 };
+		atomic_t<u32> active{ thread_count };
+		std::exception_ptr error;
+		std::mutex error_mutex;
+
+		std::vector<std::thread> threads;
+
+		for (u32 t = 0; t < thread_count; t++)
+		{
+			threads.emplace_back([&]()
+			{
+				for (u32 i; (i = next++) < total;)
+				{
+					try
+					{
+						jobs[i]();
+						finished[i] = 1;
+					}
+					catch (...)
+					{
+						std::lock_guard<std::mutex> lock(error_mutex);
+
+						if (!error)
+						{
+							error = std::current_exception();
+						}
+
+						next = total;
+					}
+
+					done++;
+				}
+
+				active--;
+			});
+		}
+
+		while (active)
+		{
+			if (!on_progress(done, total))
+			{
+				next = total;
+				break;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(16));
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		discard_unfinished();
+
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+
+		on_progress(done, total);
+	}
+
+	// Drop queued builds and wait for the ones in progress
+	void wait_for_pipeline_builds()
+	{
+		std::unique_lock<std::mutex> lock(m_pipeline_mutex);
+
+		for (const auto& job : m_build_queue)
+		{
+			m_pending_pipelines.erase(job.key);
+		}
+
+		m_build_queue.clear();
+		m_build_done_cv.wait(lock, [this]() { return m_pending_pipelines.empty(); });
+	}
+
+	void on_frame_end()
+	{
+		std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+		m_last_frame_pipeline_builds = std::exchange(m_frame_pipeline_builds, 0);
+		m_last_frame_skipped_draws = std::exchange(m_frame_skipped_draws, 0);
+	}
+
+	u32 get_pending_pipeline_count()
+	{
+		std::lock_guard<std::mutex> lock(m_pipeline_mutex);
+		return ::size32(m_pending_pipelines);
+	}
+
+	u32 get_last_frame_pipeline_builds() const
+	{
+		return m_last_frame_pipeline_builds;
+	}
+
+	u32 get_last_frame_skipped_draws() const
+	{
+		return m_last_frame_skipped_draws;
+	}
+
 	size_t get_fragment_constants_buffer_size(const RSXFragmentProgram &fragmentShader) const
 	{
 		const auto I = m_fragment_shader_cache.find(fragmentShader);
@@ -366,6 +764,10 @@ public:
 
 	void clear()
 	{
+		wait_for_pipeline_builds();
+
+		std::lock_guard<std::mutex> lock(m_pipeline_mutex);
 		m_storage.clear();
+		m_failed_pipelines.clear();
 	}
 };
@@ -584,6 +584,41 @@ namespace rsx
 			}
 		}
 
+		/**
+		 * Unbinds all surfaces and moves them to invalidated surface store.
+		 * Used when the surface contents no longer match the emulated state (frame replay)
+		 */
+		void invalidate_all(command_list_type command_list)
+		{
+			for (std::tuple<u32, surface_type> &rtt : m_bound_render_targets)
+			{
+				if (std::get<1>(rtt) != nullptr)
+					Traits::prepare_rtt_for_sampling(command_list, std::get<1>(rtt));
+				rtt = std::make_tuple(0, nullptr);
+			}
+
+			if (std::get<1>(m_bound_depth_stencil) != nullptr)
+				Traits::prepare_ds_for_sampling(command_list, std::get<1>(m_bound_depth_stencil));
+
+			m_bound_depth_stencil = std::make_tuple(0, nullptr);
+
+			for (auto &rtt : m_render_targets_storage)
+			{
+				Traits::notify_surface_invalidated(rtt.second);
+				invalidated_resources.push_back(std::move(rtt.second));
+			}
+
+			for (auto &ds : m_depth_stencil_storage)
+			{
+				Traits::notify_surface_invalidated(ds.second);
+				invalidated_resources.push_back(std::move(ds.second));
+			}
+
+			m_render_targets_storage.clear();
+			m_depth_stencil_storage.clear();
+			cache_tag++;
+		}
+
 		/**
 		 * Invalidates surface that exists at an address
 		 */
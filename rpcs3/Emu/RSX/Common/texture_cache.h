@@ -1044,6 +1044,12 @@ namespace rsx
 			return std::make_tuple(false, nullptr);
 		}
 
+		//Conservative test (no lock taken) whether the range may be protected by the cache
+		bool is_range_protected(u32 address, u32 range, bool is_writing) const
+		{
+			return region_intersects_cache(address, range, is_writing);
+		}
+
 		template <typename ...Args>
 		thrashed_set invalidate_address(u32 address, bool is_writing, bool allow_flush, Args&&... extras)
 		{
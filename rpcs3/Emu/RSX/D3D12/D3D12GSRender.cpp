@@ -719,6 +719,12 @@ bool D3D12GSRender::on_access_violation(u32 address, bool is_writing)
 	return false;
 }
 
+bool D3D12GSRender::is_memory_protected(u32 address, u32 size, bool is_writing)
+{
+	// Protected ranges are not tracked precisely, only writing is affected
+	return is_writing;
+}
+
 void D3D12GSRender::reset_timer()
 {
 	m_timers.draw_calls_count = 0;
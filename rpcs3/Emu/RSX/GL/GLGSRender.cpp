@@ -1408,6 +1408,7 @@ void GLGSRender::flip(int buffer)
 		m_text_printer.print_text(0, 54, m_frame->client_width(), m_frame->client_height(), "vertex upload time: " + std::to_string(m_vertex_upload_time) + "us");
 		m_text_printer.print_text(0, 72, m_frame->client_width(), m_frame->client_height(), "textures upload time: " + std::to_string(m_textures_upload_time) + "us");
 		m_text_printer.print_text(0, 90, m_frame->client_width(), m_frame->client_height(), "draw call execution: " + std::to_string(m_draw_time) + "us");
+		m_text_printer.print_text(0, 108, m_frame->client_width(), m_frame->client_height(), fmt::format("FIFO methods: %d (%d elided)", performance_counters.FIFO_last_frame_methods, performance_counters.FIFO_last_frame_methods_elided));
 
 		const auto num_dirty_textures = m_gl_texture_cache.get_unreleased_textures_count();
 		const auto texture_memory_size = m_gl_texture_cache.get_texture_memory_in_use() / (1024 * 1024);
@@ -1481,6 +1482,16 @@ void GLGSRender::on_notify_memory_unmapped(u32 address_base, u32 size)
 	}
 }
 
+bool GLGSRender::is_memory_protected(u32 address, u32 size, bool is_writing)
+{
+	return m_gl_texture_cache.is_range_protected(address, size, is_writing);
+}
+
+void GLGSRender::invalidate_surface_cache()
+{
+	m_rtts.invalidate_all(nullptr);
+}
+
 void GLGSRender::do_local_task(bool /*idle*/)
 {
 	m_frame->clear_wm_events();
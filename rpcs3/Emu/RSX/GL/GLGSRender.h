@@ -382,6 +382,8 @@ protected:
 
 	bool on_access_violation(u32 address, bool is_writing) override;
 	void on_notify_memory_unmapped(u32 address_base, u32 size) override;
+	bool is_memory_protected(u32 address, u32 size, bool is_writing) override;
+	void invalidate_surface_cache() override;
 	void notify_tile_unbound(u32 tile) override;
 
 	std::array<std::vector<gsl::byte>, 4> copy_render_targets_to_memory() override;
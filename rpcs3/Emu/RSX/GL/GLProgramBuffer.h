@@ -10,6 +10,9 @@ struct GLTraits
 	using pipeline_storage_type = gl::glsl::program;
 	using pipeline_properties = void*;
 
+	//Programs must be compiled and linked on the thread owning the context
+	static constexpr bool parallel_shader_compile = false;
+
 	static
 	void recompile_fragment_program(const RSXFragmentProgram &RSXFP, fragment_program_type& fragmentProgramData, size_t /*ID*/)
 	{
@@ -16,12 +16,15 @@
 
 #include <thread>
 #include <fenv.h>
+#include <sstream>
+#include <cereal/archives/binary.hpp>
 
 class GSRender;
 
 #define CMD_DEBUG 0
 
 bool user_asked_for_frame_capture = false;
+bool user_asked_for_frame_replay = false;
 rsx::frame_capture_data frame_debug;
 
 
@@ -284,6 +287,107 @@ namespace rsx
 		frame_debug.draw_calls.push_back(draw_state);
 	}
 
+	void thread::replay_frame_capture()
+	{
+		// The guest must not run while its RSX state is replaced
+		if (!Emu.IsPaused())
+		{
+			LOG_ERROR(RSX, "Frame replay: the emulation must be paused");
+			return;
+		}
+
+		const fs::file file(fs::get_config_dir() + "capture.txt");
+
+		if (!file)
+		{
+			LOG_ERROR(RSX, "Frame replay: no capture found");
+			return;
+		}
+
+		frame_capture_data capture;
+		{
+			std::stringstream is(file.to_string());
+			cereal::BinaryInputArchive archive(is);
+			archive(capture);
+		}
+
+		// Methods which write guest memory or signal the guest are not replayed
+		auto is_replayable = [](u32 reg)
+		{
+			switch (reg)
+			{
+			case NV406E_SET_REFERENCE:
+			case NV406E_SEMAPHORE_ACQUIRE:
+			case NV406E_SEMAPHORE_RELEASE:
+			case NV4097_TEXTURE_READ_SEMAPHORE_RELEASE:
+			case NV4097_BACK_END_WRITE_SEMAPHORE_RELEASE:
+			case NV4097_GET_REPORT:
+			case NV3089_IMAGE_IN:
+			case NV0039_BUFFER_NOTIFY:
+			case GCM_FLIP_COMMAND:
+				return false;
+			}
+
+			return !(reg >= NV308A_COLOR && reg < NV308A_COLOR + 768) && !(reg >= GCM_FLIP_HEAD && reg < GCM_FLIP_HEAD + 2) && !(reg >= GCM_DRIVER_QUEUE && reg < GCM_DRIVER_QUEUE + 8);
+		};
+
+		// Keep the current state to restore it afterwards
+		const auto saved_state = std::make_unique<rsx_state>();
+		*saved_state = method_registers;
+		const draw_clause saved_draw_clause = method_registers.current_draw_clause;
+		const bool saved_in_begin_end = in_begin_end;
+
+		u32 draws = 0;
+		u64 draw_time = 0;
+
+		const u64 start = get_system_time();
+
+		for (const auto& command : capture.command_queue)
+		{
+			const u32 reg = command.first;
+			const u32 value = command.second;
+
+			method_registers.decode(reg, value);
+
+			if (!is_replayable(reg))
+			{
+				continue;
+			}
+
+			if (auto method = methods[reg])
+			{
+				if (reg == NV4097_SET_BEGIN_END && !value)
+				{
+					const u64 draw_start = get_system_time();
+					method(this, reg, value);
+					draw_time += get_system_time() - draw_start;
+					draws++;
+					continue;
+				}
+
+				method(this, reg, value);
+			}
+		}
+
+		const u64 elapsed = std::max<u64>(get_system_time() - start, 1);
+
+		method_registers = *saved_state;
+		method_registers.current_draw_clause = saved_draw_clause;
+		in_begin_end = saved_in_begin_end;
+
+		// Surfaces now hold the replayed frame
+		invalidate_surface_cache();
+
+		// Make the backend reevaluate the restored state
+		m_rtts_dirty = true;
+		memset(m_textures_dirty, -1, sizeof(m_textures_dirty));
+		memset(m_vertex_textures_dirty, -1, sizeof(m_vertex_textures_dirty));
+		m_transform_constants_dirty = true;
+
+		LOG_SUCCESS(RSX, "Frame replay: %u methods, %u draws in %u us (%.0f methods/s, %.0f draws/s, %u us in draw calls)",
+			::size32(capture.command_queue), draws, elapsed, capture.command_queue.size() * 1000000. / elapsed, draws * 1000000. / elapsed, draw_time);
+	}
+
 	void thread::begin()
 	{
 		rsx::method_registers.current_draw_clause.inline_vertex_array.resize(0);
@@ -382,7 +486,10 @@ namespace rsx
 			// TODO: exit condition
 			while (!Emu.IsStopped() && !m_rsx_thread_exiting)
 			{
-				if (get_system_time() - start_time > vblank_count * 1000000 / 60)
+				const u64 elapsed = get_system_time() - start_time;
+				const u64 next_vblank = vblank_count * 1000000 / 60;
+
+				if (elapsed > next_vblank)
 				{
 					vblank_count++;
 					sys_rsx_context_attribute(0x55555555, 0xFED, 1, 0, 0, 0);
@@ -401,10 +508,16 @@ namespace rsx
 					continue;
 				}
 
-				while (Emu.IsPaused() && !m_rsx_thread_exiting)
-					std::this_thread::sleep_for(10ms);
+				if (Emu.IsPaused())
+				{
+					while (Emu.IsPaused() && !m_rsx_thread_exiting)
+						std::this_thread::sleep_for(10ms);
 
-				std::this_thread::sleep_for(1ms); // hack
+					continue;
+				}
+
+				// Sleep until the next vblank is due
+				thread_ctrl::wait_for(next_vblank - elapsed + 1);
 			}
 		});
 
@@ -512,6 +625,19 @@ namespace rsx
 			//Update sub-units
 			zcull_ctrl->update(this);
 
+			//Replay a frame capture if requested by the debugger
+			if (user_asked_for_frame_replay)
+			{
+				user_asked_for_frame_replay = false;
+
+				if (has_deferred_call)
+				{
+					flush_command_queue();
+				}
+
+				replay_frame_capture();
+			}
+
 			//Set up restore state if needed
 			if (sync_point_request)
 			{
@@ -581,7 +707,7 @@ namespace rsx
 				continue;
 			}
 
-			const u32 cmd = ReadIO32(internal_get);
+			const u32 cmd = vm::read32(get_address);
 			const u32 count = (cmd >> 18) & 0x7ff;
 
 			if ((cmd & RSX_METHOD_OLD_JUMP_CMD_MASK) == RSX_METHOD_OLD_JUMP_CMD)
@@ -669,11 +795,55 @@ namespace rsx
 			if (internal_get < put && ((internal_get + (count + 1) * 4) > put))
 				LOG_ERROR(RSX, "Get pointer jumping over put pointer! This is bad!");
 
+			const bool non_increment = (cmd & RSX_METHOD_NON_INCREMENT_CMD_MASK) == RSX_METHOD_NON_INCREMENT_CMD;
+
+			performance_counters.FIFO_methods += count;
+
+			//Transform constant uploads are applied as a single ranged update
+			if (count != 0 && !non_increment && !unaligned_command && !capture_current_frame &&
+				first_cmd >= NV4097_SET_TRANSFORM_CONSTANT && first_cmd + count <= NV4097_SET_TRANSFORM_CONSTANT + 32)
+			{
+				if (supports_multidraw && has_deferred_call)
+				{
+					flush_command_queue();
+				}
+
+				const u32 load = method_registers.transform_constant_load();
+				const u32 index = first_cmd - NV4097_SET_TRANSFORM_CONSTANT;
+
+				for (u32 i = 0; i < count; i++)
+				{
+					const u32 value = args[i];
+					method_registers.decode(first_cmd + i, value);
+
+					if ((load + index + i) >= 512)
+					{
+						LOG_ERROR(RSX, "Invalid register index (load=%d, index=%d)", load, index + i);
+						continue;
+					}
+
+					method_registers.transform_constants[load + (index + i) / 4][(index + i) % 4] = value;
+				}
+
+				m_transform_constants_dirty = true;
+				performance_counters.FIFO_methods_elided += count - 1;
+
+				internal_get += (count + 1) * 4;
+				continue;
+			}
+
 			for (u32 i = 0; i < count; i++)
 			{
-				u32 reg = ((cmd & RSX_METHOD_NON_INCREMENT_CMD_MASK) == RSX_METHOD_NON_INCREMENT_CMD) ? first_cmd : first_cmd + i;
+				u32 reg = non_increment ? first_cmd : first_cmd + i;
 				u32 value = args[i];
 
+				//Registers without a handler only hold state: an unchanged value or a value overwritten by the same command has no effect
+				if (!methods[reg] && !capture_current_frame && ((non_increment && i + 1 < count) || method_registers.test(reg, value)))
+				{
+					performance_counters.FIFO_methods_elided++;
+					continue;
+				}
+
 				bool execute_method_call = true;
 
 				//TODO: Flatten draw calls when multidraw is not supported to simplify checking in the end() methods
@@ -2123,6 +2293,11 @@ namespace rsx
 		}
 
 		performance_counters.sampled_frames++;
+
+		performance_counters.FIFO_last_frame_methods = performance_counters.FIFO_methods;
+		performance_counters.FIFO_last_frame_methods_elided = performance_counters.FIFO_methods_elided;
+		performance_counters.FIFO_methods = 0;
+		performance_counters.FIFO_methods_elided = 0;
 	}
 
 	void thread::check_zcull_status(bool framebuffer_swap)
@@ -27,6 +27,7 @@
 extern u64 get_system_time();
 
 extern bool user_asked_for_frame_capture;
+extern bool user_asked_for_frame_replay;
 extern rsx::frame_capture_data frame_debug;
 
 namespace rsx
@@ -291,6 +292,10 @@ namespace rsx
 			bool FIFO_is_idle = false; //True if FIFO is in idle state
 			u32 approximate_load = 0;
 			u32 sampled_frames = 0;
+			u32 FIFO_methods = 0; //Methods processed in the current frame
+			u32 FIFO_methods_elided = 0; //Methods skipped in the current frame (redundant or batched)
+			u32 FIFO_last_frame_methods = 0;
+			u32 FIFO_last_frame_methods_elided = 0;
 		}
 		performance_counters;
 
@@ -303,6 +308,9 @@ namespace rsx
 		bool capture_current_frame = false;
 		void capture_frame(const std::string &name);
 
+		// Replay the last saved frame capture through the method handlers and report timings
+		void replay_frame_capture();
+
 	public:
 		std::shared_ptr<class ppu_thread> intr_thread;
 
@@ -406,7 +414,9 @@ namespace rsx
 		virtual u64 timestamp() const;
 		virtual bool on_access_violation(u32 /*address*/, bool /*is_writing*/) { return false; }
 		virtual void on_notify_memory_unmapped(u32 /*address_base*/, u32 /*size*/) {}
+		virtual bool is_memory_protected(u32 /*address*/, u32 /*size*/, bool /*is_writing*/) { return false; }
 		virtual void notify_tile_unbound(u32 /*tile*/) {}
+		virtual void invalidate_surface_cache() {}
 
 		//zcull
 		void notify_zcull_info_changed();
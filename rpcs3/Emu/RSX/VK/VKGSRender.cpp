@@ -858,6 +858,17 @@ void VKGSRender::on_notify_memory_unmapped(u32 address_base, u32 size)
 	}
 }
 
+bool VKGSRender::is_memory_protected(u32 address, u32 size, bool is_writing)
+{
+	return m_texture_cache.is_range_protected(address, size, is_writing);
+}
+
+void VKGSRender::invalidate_surface_cache()
+{
+	close_render_pass();
+	m_rtts.invalidate_all(&*m_current_command_buffer);
+}
+
 void VKGSRender::notify_tile_unbound(u32 tile)
 {
 	//TODO: Handle texture writeback
@@ -1199,7 +1210,12 @@ void VKGSRender::end()
 
 	//Load program
 	std::chrono::time_point<steady_clock> program_start = textures_end;
-	load_program(upload_info);
+	if (!load_program(upload_info))
+	{
+		//Pipeline is still being compiled, skip the draw
+		rsx::thread::end();
+		return;
+	}
 
 	VkBufferView persistent_buffer = m_persistent_attribute_storage ? m_persistent_attribute_storage->value : null_buffer_view->value;
 	VkBufferView volatile_buffer = m_volatile_attribute_storage ? m_volatile_attribute_storage->value : null_buffer_view->value;
@@ -1548,7 +1564,7 @@ void VKGSRender::on_init_thread()
 	{
 		m_frame->disable_wm_event_queue();
 		m_frame->hide();
-		m_shaders_cache->load(nullptr, *m_device, pipeline_layout);
+		m_shaders_cache->load(nullptr, (VkDevice)*m_device, pipeline_layout);
 		m_frame->enable_wm_event_queue();
 		m_frame->show();
 	}
@@ -1598,7 +1614,7 @@ void VKGSRender::on_init_thread()
 
 		//TODO: Handle window resize messages during loading on GPUs without OUT_OF_DATE_KHR support
 		m_frame->disable_wm_event_queue();
-		m_shaders_cache->load(&helper, *m_device, pipeline_layout);
+		m_shaders_cache->load(&helper, (VkDevice)*m_device, pipeline_layout);
 		m_frame->enable_wm_event_queue();
 	}
 }
@@ -2126,7 +2142,7 @@ bool VKGSRender::check_program_status()
 	return (rsx::method_registers.shader_program_address() != 0);
 }
 
-void VKGSRender::load_program(const vk::vertex_upload_info& vertex_info)
+bool VKGSRender::load_program(const vk::vertex_upload_info& vertex_info)
 {
 	get_current_fragment_program(fs_sampler_state);
 	verify(HERE), current_fragment_program.valid;
@@ -2296,7 +2312,15 @@ void VKGSRender::load_program(const vk::vertex_upload_info& vertex_info)
 	//Load current program from buffer
 	vertex_program.skip_vertex_input_check = true;
 	fragment_program.unnormalized_coords = 0;
-	m_program = m_prog_buffer->getGraphicPipelineState(vertex_program, fragment_program, properties, *m_device, pipeline_layout).get();
+	if (g_cfg.video.vk.async_pipeline_compile)
+	{
+		auto pipeline = m_prog_buffer->getGraphicPipelineStateAsync(vertex_program, fragment_program, properties, (VkDevice)*m_device, pipeline_layout);
+		m_program = pipeline ? pipeline->get() : nullptr;
+	}
+	else
+	{
+		m_program = m_prog_buffer->getGraphicPipelineState(vertex_program, fragment_program, properties, *m_device, pipeline_layout).get();
+	}
 
 	if (m_prog_buffer->check_cache_missed())
 	{
@@ -2317,6 +2341,11 @@ void VKGSRender::load_program(const vk::vertex_upload_info& vertex_info)
 
 	vk::leave_uninterruptible();
 
+	if (!m_program)
+	{
+		return false;
+	}
+
 	const size_t fragment_constants_sz = m_prog_buffer->get_fragment_constants_buffer_size(fragment_program);
 	const size_t fragment_buffer_sz = fragment_constants_sz + (18 * 4 * sizeof(float));
 	const size_t required_mem = 512 + 8192 + fragment_buffer_sz;
@@ -2360,6 +2389,7 @@ void VKGSRender::load_program(const vk::vertex_upload_info& vertex_info)
 	m_program->bind_uniform({ m_uniform_buffer_ring_info.heap->value, vertex_state_offset, 512 }, SCALE_OFFSET_BIND_SLOT, m_current_frame->descriptor_set);
 	m_program->bind_uniform({ m_uniform_buffer_ring_info.heap->value, vertex_constants_offset, 8192 }, VERTEX_CONSTANT_BUFFERS_BIND_SLOT, m_current_frame->descriptor_set);
 	m_program->bind_uniform({ m_uniform_buffer_ring_info.heap->value, fragment_constants_offset, fragment_buffer_sz }, FRAGMENT_CONSTANT_BUFFERS_BIND_SLOT, m_current_frame->descriptor_set);
+	return true;
 }
 
 static const u32 mr_color_offset[rsx::limits::color_buffers_count] =
@@ -2910,6 +2940,8 @@ void VKGSRender::reinitialize_swapchain()
 
 void VKGSRender::flip(int buffer)
 {
+	m_prog_buffer->on_frame_end();
+
 	if (skip_frame || renderer_unavailable)
 	{
 		m_frame->flip(m_context);
@@ -3155,6 +3187,7 @@ void VKGSRender::flip(int buffer)
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 72, direct_fbo->width(), direct_fbo->height(), "texture upload time: " + std::to_string(m_textures_upload_time) + "us");
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 90, direct_fbo->width(), direct_fbo->height(), "draw call execution: " + std::to_string(m_draw_time) + "us");
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 108, direct_fbo->width(), direct_fbo->height(), "submit and flip: " + std::to_string(m_flip_time) + "us");
+			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 126, direct_fbo->width(), direct_fbo->height(), fmt::format("FIFO methods: %d (%d elided)", performance_counters.FIFO_last_frame_methods, performance_counters.FIFO_last_frame_methods_elided));
 
 			const  auto num_dirty_textures = m_texture_cache.get_unreleased_textures_count();
 			const auto texture_memory_size = m_texture_cache.get_texture_memory_in_use() / (1024 * 1024);
@@ -3166,6 +3199,7 @@ void VKGSRender::flip(int buffer)
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 162, direct_fbo->width(), direct_fbo->height(), "Texture cache memory: " + std::to_string(texture_memory_size) + "M");
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 180, direct_fbo->width(), direct_fbo->height(), "Temporary texture memory: " + std::to_string(tmp_texture_memory_size) + "M");
 			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 198, direct_fbo->width(), direct_fbo->height(), fmt::format("Flush requests: %d (%d%% hard faults, %d mispedictions)", num_flushes, cache_miss_ratio, num_mispredict));
+			m_text_writer->print_text(*m_current_command_buffer, *direct_fbo, 0, 216, direct_fbo->width(), direct_fbo->height(), fmt::format("Pipeline compiles: %d pending, %d queued (%d draws skipped)", m_prog_buffer->get_pending_pipeline_count(), m_prog_buffer->get_last_frame_pipeline_builds(), m_prog_buffer->get_last_frame_skipped_draws()));
 		}
 
 		vk::change_image_layout(*m_current_command_buffer, target_image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, present_layout, subres);
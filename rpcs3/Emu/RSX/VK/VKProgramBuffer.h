@@ -79,6 +79,9 @@ struct VKTraits
 	using pipeline_storage_type = std::unique_ptr<vk::glsl::program>;
 	using pipeline_properties = vk::pipeline_props;
 
+	//Shader modules and pipelines can be created from any thread
+	static constexpr bool parallel_shader_compile = true;
+
 	static
 	void recompile_fragment_program(const RSXFragmentProgram &RSXFP, fragment_program_type& fragmentProgramData, size_t ID)
 	{
@@ -109,6 +112,9 @@ struct VKTraits
 	pipeline_storage_type build_pipeline(const vertex_program_type &vertexProgramData, const fragment_program_type &fragmentProgramData,
 			const vk::pipeline_props &pipelineProperties, VkDevice dev, VkPipelineLayout common_pipeline_layout)
 	{
+		//The properties may have been copied (async build), point the blend state to its own attachments
+		vk::pipeline_props props = pipelineProperties;
+		props.cs.pAttachments = props.att_state;
 
 		VkPipelineShaderStageCreateInfo shader_stages[2] = {};
 		shader_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -151,19 +157,19 @@ struct VKTraits
 		VkGraphicsPipelineCreateInfo info = {};
 		info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 		info.pVertexInputState = &vi;
-		info.pInputAssemblyState = &pipelineProperties.ia;
-		info.pRasterizationState = &pipelineProperties.rs;
-		info.pColorBlendState = &pipelineProperties.cs;
+		info.pInputAssemblyState = &props.ia;
+		info.pRasterizationState = &props.rs;
+		info.pColorBlendState = &props.cs;
 		info.pMultisampleState = &ms;
 		info.pViewportState = &vp;
-		info.pDepthStencilState = &pipelineProperties.ds;
+		info.pDepthStencilState = &props.ds;
 		info.stageCount = 2;
 		info.pStages = shader_stages;
 		info.pDynamicState = &dynamic_state_info;
 		info.layout = common_pipeline_layout;
 		info.basePipelineIndex = -1;
 		info.basePipelineHandle = VK_NULL_HANDLE;
-		info.renderPass = pipelineProperties.render_pass;
+		info.renderPass = props.render_pass;
 
 		CHECK_RESULT(vkCreateGraphicsPipelines(dev, nullptr, 1, &info, NULL, &pipeline));
 		pipeline_storage_type result = std::make_unique<vk::glsl::program>(dev, pipeline, vertexProgramData.uniforms, fragmentProgramData.uniforms);
@@ -210,7 +216,7 @@ public:
 		props.render_pass = m_render_pass_data[props.render_pass_location];
 		props.cs.pAttachments = props.att_state;
 		vp.skip_vertex_input_check = true;
-		getGraphicPipelineState(vp, fp, props, std::forward<Args>(args)...);
+		preloadGraphicPipelineState(vp, fp, props, std::forward<Args>(args)...);
 	}
 
 	bool check_cache_missed() const
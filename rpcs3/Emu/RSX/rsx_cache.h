@@ -7,6 +7,8 @@
 #include "Emu/Cell/Modules/cellMsgDialog.h"
 #include "Emu/System.h"
 
+#include <unordered_set>
+
 namespace rsx
 {
 	struct blit_src_info
@@ -272,11 +274,44 @@ namespace rsx
 			pipeline_storage_type pipeline_properties;
 		};
 
+		// The cache is a single append-only file per pipeline class: an archive_header followed by records.
+		// Each record is a record_header followed by 'size' bytes of payload. Program ucode is written once
+		// and shared by all the pipeline records referencing its hash.
+		struct archive_header
+		{
+			u32 magic;
+			u32 pipeline_data_size;
+			char version[8];
+		};
+
+		struct record_header
+		{
+			u32 type;
+			u32 size;
+			u64 hash;
+		};
+
+		enum record_type : u32
+		{
+			record_vertex_program = 1,
+			record_fragment_program = 2,
+			record_pipeline = 3,
+		};
+
+		static constexpr u32 archive_magic = 0x43535852; // "RXSC"
+
 		std::string version_prefix;
 		std::string root_path;
 		std::string pipeline_class_name;
+		std::unordered_map<u64, std::vector<u32>> vertex_program_data;
 		std::unordered_map<u64, std::vector<u8>> fragment_program_data;
 
+		// Contents of the archive, nothing is appended twice
+		fs::file archive;
+		std::unordered_set<u64> stored_vertex_programs;
+		std::unordered_set<u64> stored_fragment_programs;
+		std::unordered_set<u64> stored_pipelines;
+
 		backend_storage& m_storage;
 
 	public:
@@ -348,30 +383,47 @@ namespace rsx
 				return;
 			}
 
-			std::string directory_path = root_path + "/pipelines/" + pipeline_class_name;
+			std::vector<pipeline_data> pipelines = open_archive();
 
-			if (!fs::is_dir(directory_path))
+			if (!archive)
 			{
-				fs::create_path(directory_path);
-				fs::create_path(root_path + "/raw");
-
 				return;
 			}
 
-			fs::dir root = fs::dir(directory_path);
-			fs::dir_entry tmp;
+			if (pipelines.empty())
+			{
+				import_legacy_cache(pipelines);
+			}
 
-			u32 entry_count = 0;
-			for (auto It = root.begin(); It != root.end(); ++It, entry_count++);
+			// Unpack the entries, every distinct program is compiled once before the pipelines are built
+			std::vector<std::tuple<pipeline_storage_type, RSXVertexProgram, RSXFragmentProgram>> entries;
+			std::vector<RSXVertexProgram> vertex_programs;
+			std::vector<RSXFragmentProgram> fragment_programs;
 
-			if (entry_count <= 2)
-				return;
+			entries.reserve(pipelines.size());
+			vertex_programs.reserve(pipelines.size());
+			fragment_programs.reserve(pipelines.size());
 
-			entry_count -= 2;
-			f32 delta = 100.f / entry_count;
-			f32 tally = 0.f;
+			for (auto& data : pipelines)
+			{
+				if (!vertex_program_data.count(data.vertex_program_hash) || !fragment_program_data.count(data.fragment_program_hash))
+				{
+					LOG_ERROR(RSX, "Cached pipeline object references missing programs (vp=0x%llx, fp=0x%llx)", data.vertex_program_hash, data.fragment_program_hash);
+					continue;
+				}
 
-			root.rewind();
+				entries.push_back(unpack(data));
+				vertex_programs.push_back(std::get<1>(entries.back()));
+				fragment_programs.push_back(std::get<2>(entries.back()));
+			}
+
+			pipelines.clear();
+
+			const u32 entry_count = ::size32(entries);
+			if (entry_count == 0)
+			{
+				return;
+			}
 
 			// Progress dialog
 			std::unique_ptr<progress_dialog_helper> fallback_dlg;
@@ -382,68 +434,287 @@ namespace rsx
 			}
 
 			dlg->create();
+			dlg->update_msg(0, entry_count);
 
-			const auto prefix_length = version_prefix.length();
-			u32 processed = 0;
-			while (root.read(tmp) && !Emu.IsStopped())
+			// The bar is split between the program compilation (0-50) and the pipeline builds (50-100)
+			u32 progress = 0;
+			u32 reported = 0;
+			auto set_progress = [&](u32 value)
 			{
-				if (tmp.name == "." || tmp.name == "..")
-					continue;
+				if (value > progress)
+				{
+					dlg->inc_value(value - progress);
+					progress = value;
+				}
+			};
 
-				if (tmp.name.compare(0, prefix_length, version_prefix) != 0)
-					continue;
+			auto report_pipelines = [&](u32 done)
+			{
+				if (done != reported)
+				{
+					reported = done;
+					dlg->update_msg(done, entry_count);
+					set_progress(50 + done * 50 / entry_count);
+				}
+			};
 
-				std::vector<u8> bytes;
-				fs::file f(directory_path + "/" + tmp.name);
+			m_storage.preload_programs(vertex_programs, fragment_programs, [&](u32 done, u32 total)
+			{
+				set_progress(done * 50 / total);
+				return !Emu.IsStopped();
+			});
 
-				processed++;
-				dlg->update_msg(processed, entry_count);
+			vertex_programs.clear();
+			fragment_programs.clear();
 
-				if (f.size() != sizeof(pipeline_data))
+			u32 processed = 0;
+			for (auto& entry : entries)
+			{
+				if (Emu.IsStopped())
 				{
-					LOG_ERROR(RSX, "Cached pipeline object %s is not binary compatible with the current shader cache", tmp.name.c_str());
-					continue;
+					break;
 				}
 
-				f.read<u8>(bytes, f.size());
-				auto unpacked = unpack(*(pipeline_data*)bytes.data());
-				m_storage.add_pipeline_entry(std::get<1>(unpacked), std::get<2>(unpacked), std::get<0>(unpacked), std::forward<Args>(args)...);
+				m_storage.add_pipeline_entry(std::get<1>(entry), std::get<2>(entry), std::get<0>(entry), std::forward<Args>(args)...);
+				report_pipelines(++processed - m_storage.get_pending_pipeline_count());
+			}
 
-				tally += delta;
-				if (tally > 1.f)
+			// Backends building pipelines asynchronously may still have work in flight
+			while (!Emu.IsStopped())
+			{
+				const u32 pending = m_storage.get_pending_pipeline_count();
+				if (!pending)
 				{
-					u32 value = (u32)tally;
-					dlg->inc_value(value);
-
-					tally -= (f32)value;
+					break;
 				}
+
+				report_pipelines(processed - pending);
+				std::this_thread::sleep_for(std::chrono::milliseconds(16));
 			}
 
+			m_storage.wait_for_pipeline_builds();
+
+			// The program cache keeps its own copy of the ucode
+			vertex_program_data.clear();
+			fragment_program_data.clear();
+
 			dlg->close();
 		}
 
 		void store(pipeline_storage_type &pipeline, RSXVertexProgram &vp, RSXFragmentProgram &fp)
 		{
-			if (g_cfg.video.disable_on_disk_shader_cache)
+			if (g_cfg.video.disable_on_disk_shader_cache || !archive)
 			{
 				return;
 			}
 
 			pipeline_data data = pack(pipeline, vp, fp);
-			std::string fp_name = root_path + "/raw/" + fmt::format("%llX.fp", data.fragment_program_hash);
-			std::string vp_name = root_path + "/raw/" + fmt::format("%llX.vp", data.vertex_program_hash);
 
-			if (!fs::is_file(fp_name))
+			if (!stored_pipelines.insert(get_pipeline_hash(data)).second)
+			{
+				return;
+			}
+
+			// Programs go first so that a pipeline record never precedes its ucode
+			if (stored_fragment_programs.insert(data.fragment_program_hash).second)
 			{
 				const auto size = program_hash_util::fragment_program_utils::get_fragment_program_ucode_size(fp.addr);
-				fs::file(fp_name, fs::rewrite).write(fp.addr, size);
+				append_record(record_fragment_program, data.fragment_program_hash, fp.addr, ::narrow<u32>(size));
+			}
+
+			if (stored_vertex_programs.insert(data.vertex_program_hash).second)
+			{
+				append_record(record_vertex_program, data.vertex_program_hash, vp.data.data(), ::size32(vp.data) * sizeof(u32));
+			}
+
+			append_record(record_pipeline, 0, &data, sizeof(pipeline_data));
+		}
+
+	private:
+
+		archive_header make_archive_header() const
+		{
+			archive_header header = {};
+			header.magic = archive_magic;
+			header.pipeline_data_size = sizeof(pipeline_data);
+			std::memcpy(header.version, version_prefix.data(), std::min(version_prefix.size(), sizeof(header.version)));
+			return header;
+		}
+
+		// Open the archive and read all its records. An incompatible archive is reset and a
+		// truncated tail left by an interrupted write is cut off.
+		std::vector<pipeline_data> open_archive()
+		{
+			std::vector<pipeline_data> pipelines;
+
+			const std::string archive_path = root_path + "/" + pipeline_class_name + ".bin";
+			const archive_header expected_header = make_archive_header();
+
+			fs::create_path(root_path);
+
+			if (!archive.open(archive_path, fs::read + fs::write + fs::create))
+			{
+				LOG_ERROR(RSX, "Failed to open the shader cache %s", archive_path);
+				return pipelines;
 			}
 
-			if (!fs::is_file(vp_name))
+			std::vector<u8> bytes;
+			archive.read<u8>(bytes, archive.size());
+
+			if (bytes.size() < sizeof(archive_header) || std::memcmp(bytes.data(), &expected_header, sizeof(archive_header)) != 0)
 			{
-				fs::file(vp_name, fs::rewrite).write<u32>(vp.data);
+				if (!bytes.empty())
+				{
+					LOG_WARNING(RSX, "Shader cache %s is not binary compatible with the current version and was reset", archive_path);
+				}
+
+				archive.trunc(0);
+				archive.seek(0);
+				archive.write(expected_header);
+				return pipelines;
 			}
 
+			u64 pos = sizeof(archive_header);
+
+			while (pos + sizeof(record_header) <= bytes.size())
+			{
+				record_header header;
+				std::memcpy(&header, bytes.data() + pos, sizeof(record_header));
+
+				const u8* payload = bytes.data() + pos + sizeof(record_header);
+				const u64 next = pos + sizeof(record_header) + header.size;
+
+				if (next > bytes.size())
+				{
+					break;
+				}
+
+				if (header.type == record_vertex_program && header.size % sizeof(u32) == 0)
+				{
+					auto& data = vertex_program_data[header.hash];
+					data.resize(header.size / sizeof(u32));
+					std::memcpy(data.data(), payload, header.size);
+					stored_vertex_programs.insert(header.hash);
+				}
+				else if (header.type == record_fragment_program)
+				{
+					fragment_program_data[header.hash].assign(payload, payload + header.size);
+					stored_fragment_programs.insert(header.hash);
+				}
+				else if (header.type == record_pipeline && header.size == sizeof(pipeline_data))
+				{
+					pipeline_data data;
+					std::memcpy(&data, payload, sizeof(pipeline_data));
+
+					if (stored_pipelines.insert(get_pipeline_hash(data)).second)
+					{
+						pipelines.push_back(data);
+					}
+				}
+				else
+				{
+					break;
+				}
+
+				pos = next;
+			}
+
+			if (pos != bytes.size())
+			{
+				LOG_ERROR(RSX, "Shader cache %s is damaged at offset 0x%llx, %llu bytes were discarded", archive_path, pos, bytes.size() - pos);
+				archive.trunc(pos);
+			}
+
+			archive.seek(pos);
+			LOG_NOTICE(RSX, "Shader cache %s: %u pipelines, %u vertex programs, %u fragment programs", archive_path, ::size32(pipelines), ::size32(vertex_program_data), ::size32(fragment_program_data));
+
+			return pipelines;
+		}
+
+		// Move the entries of the old one-file-per-pipeline layout (pipelines/<class>/*.bin and raw/*.vp, raw/*.fp) into the archive
+		void import_legacy_cache(std::vector<pipeline_data>& pipelines)
+		{
+			const std::string directory_path = root_path + "/pipelines/" + pipeline_class_name;
+
+			if (!fs::is_dir(directory_path))
+			{
+				return;
+			}
+
+			fs::dir root(directory_path);
+			fs::dir_entry tmp;
+
+			const auto prefix_length = version_prefix.length();
+			while (root.read(tmp) && !Emu.IsStopped())
+			{
+				if (tmp.name == "." || tmp.name == "..")
+					continue;
+
+				if (tmp.name.compare(0, prefix_length, version_prefix) != 0)
+					continue;
+
+				fs::file f(directory_path + "/" + tmp.name);
+
+				if (f.size() != sizeof(pipeline_data))
+				{
+					LOG_ERROR(RSX, "Cached pipeline object %s is not binary compatible with the current shader cache", tmp.name.c_str());
+					continue;
+				}
+
+				pipeline_data data;
+				f.read(data);
+
+				if (!vertex_program_data.count(data.vertex_program_hash))
+				{
+					fs::file vp_file(root_path + "/raw/" + fmt::format("%llX.vp", data.vertex_program_hash));
+					if (!vp_file)
+						continue;
+
+					auto& vp_data = vertex_program_data[data.vertex_program_hash];
+					vp_file.read<u32>(vp_data, vp_file.size() / sizeof(u32));
+
+					stored_vertex_programs.insert(data.vertex_program_hash);
+					append_record(record_vertex_program, data.vertex_program_hash, vp_data.data(), ::size32(vp_data) * sizeof(u32));
+				}
+
+				if (!fragment_program_data.count(data.fragment_program_hash))
+				{
+					fs::file fp_file(root_path + "/raw/" + fmt::format("%llX.fp", data.fragment_program_hash));
+					if (!fp_file)
+						continue;
+
+					auto& fp_data = fragment_program_data[data.fragment_program_hash];
+					fp_file.read<u8>(fp_data, fp_file.size());
+
+					stored_fragment_programs.insert(data.fragment_program_hash);
+					append_record(record_fragment_program, data.fragment_program_hash, fp_data.data(), ::size32(fp_data));
+				}
+
+				if (stored_pipelines.insert(get_pipeline_hash(data)).second)
+				{
+					append_record(record_pipeline, 0, &data, sizeof(pipeline_data));
+					pipelines.push_back(data);
+				}
+			}
+
+			if (!pipelines.empty())
+			{
+				LOG_SUCCESS(RSX, "Imported %u pipelines from the legacy shader cache %s", ::size32(pipelines), directory_path);
+			}
+		}
+
+		void append_record(u32 type, u64 hash, const void* payload, u32 size)
+		{
+			// Written with a single call so that an interrupted write can only damage the tail
+			std::vector<u8> record(sizeof(record_header) + size);
+			const record_header header = { type, size, hash };
+			std::memcpy(record.data(), &header, sizeof(record_header));
+			std::memcpy(record.data() + sizeof(record_header), payload, size);
+			archive.write(record);
+		}
+
+		static u64 get_state_hash(const pipeline_data& data)
+		{
 			u64 state_hash = 0;
 			state_hash ^= rpcs3::hash_base<u32>(data.vp_ctrl);
 			state_hash ^= rpcs3::hash_base<u32>(data.fp_ctrl);
@@ -456,46 +727,25 @@ namespace rsx
 			state_hash ^= rpcs3::hash_base<u16>(data.fp_redirected_textures);
 			state_hash ^= rpcs3::hash_base<u16>(data.fp_alphakill_mask);
 			state_hash ^= rpcs3::hash_base<u64>(data.fp_zfunc_mask);
-
-			std::string pipeline_file_name = fmt::format("%llX+%llX+%llX+%llX.bin", data.vertex_program_hash, data.fragment_program_hash, data.pipeline_storage_hash, state_hash);
-			std::string pipeline_path = root_path + "/pipelines/" + pipeline_class_name + "/" + version_prefix + "-" + pipeline_file_name;
-			fs::file(pipeline_path, fs::rewrite).write(&data, sizeof(pipeline_data));
+			return state_hash;
 		}
 
-		RSXVertexProgram load_vp_raw(u64 program_hash)
+		// Identifies a pipeline entry, pipeline_properties may hold pointers and cannot be compared directly
+		static u64 get_pipeline_hash(const pipeline_data& data)
 		{
-			std::vector<u32> data;
-			std::string filename = fmt::format("%llX.vp", program_hash);
-
-			fs::file f(root_path + "/raw/" + filename);
-			f.read<u32>(data, f.size() / sizeof(u32));
-
-			RSXVertexProgram vp = {};
-			vp.data = data;
-			vp.skip_vertex_input_check = true;
-
-			return vp;
+			const std::array<u64, 4> key = { data.vertex_program_hash, data.fragment_program_hash, data.pipeline_storage_hash, get_state_hash(data) };
+			return rpcs3::hash_struct(key);
 		}
 
-		RSXFragmentProgram load_fp_raw(u64 program_hash)
+		std::tuple<pipeline_storage_type, RSXVertexProgram, RSXFragmentProgram> unpack(pipeline_data &data)
 		{
-			std::vector<u8> data;
-			std::string filename = fmt::format("%llX.fp", program_hash);
-
-			fs::file f(root_path + "/raw/" + filename);
-			f.read<u8>(data, f.size());
+			RSXVertexProgram vp = {};
+			vp.data = vertex_program_data[data.vertex_program_hash];
+			vp.skip_vertex_input_check = true;
 
 			RSXFragmentProgram fp = {};
-			fragment_program_data[program_hash] = data;
-			fp.addr = fragment_program_data[program_hash].data();
-
-			return fp;
-		}
+			fp.addr = fragment_program_data[data.fragment_program_hash].data();
 
-		std::tuple<pipeline_storage_type, RSXVertexProgram, RSXFragmentProgram> unpack(pipeline_data &data)
-		{
-			RSXVertexProgram vp = load_vp_raw(data.vertex_program_hash);
-			RSXFragmentProgram fp = load_fp_raw(data.fragment_program_hash);
 			pipeline_storage_type pipeline = data.pipeline_properties;
 
 			vp.output_mask = data.vp_ctrl;
@@ -22,6 +22,12 @@ enum class ppu_decoder_type
 	llvm,
 };
 
+enum class ppu_llvm_opt_type
+{
+	fast, // Minimal optimizations, shortest compilation time
+	throughput, // Full scalar optimization pipeline
+};
+
 enum class spu_decoder_type
 {
 	precise,
@@ -289,6 +295,7 @@ struct cfg_root : cfg::node
 		cfg::_bool llvm_logs{this, "Save LLVM logs"};
 		cfg::string llvm_cpu{this, "Use LLVM CPU"};
 		cfg::_int<0, INT32_MAX> llvm_threads{this, "Max LLVM Compile Threads", 0};
+		cfg::_enum<ppu_llvm_opt_type> llvm_opt{this, "PPU LLVM Optimization", ppu_llvm_opt_type::fast};
 
 #ifdef _WIN32
 		cfg::_bool thread_scheduler_enabled{ this, "Enable thread scheduler", true };
@@ -299,12 +306,16 @@ struct cfg_root : cfg::node
 		cfg::_enum<spu_decoder_type> spu_decoder{this, "SPU Decoder", spu_decoder_type::asmjit};
 		cfg::_bool lower_spu_priority{this, "Lower SPU thread priority"};
 		cfg::_bool spu_debug{this, "SPU Debug"};
+		cfg::_bool spu_cache{this, "SPU Cache", true}; // Save analysed SPU functions and precompile them on boot
+		cfg::_bool spu_async_compile{this, "Asynchronous SPU Compilation", true}; // Interpret SPU functions while they are compiled in background
+		cfg::_int<0, INT32_MAX> spu_compile_threads{this, "Max SPU Compile Threads", 0};
 		cfg::_int<0, 6> preferred_spu_threads{this, "Preferred SPU Threads", 0}; //Numnber of hardware threads dedicated to heavy simultaneous spu tasks
 		cfg::_int<0, 16> spu_delay_penalty{this, "SPU delay penalty", 3}; //Number of milliseconds to block a thread if a virtual 'core' isn't free
 		cfg::_bool spu_loop_detection{this, "SPU loop detection", true}; //Try to detect wait loops and trigger thread yield
 
 		cfg::_enum<lib_loading_type> lib_loading{this, "Lib Loader", lib_loading_type::liblv2only};
 		cfg::_bool hook_functions{this, "Hook static functions"};
+		cfg::_bool reservation_stats{this, "Reservation Statistics"}; // Count reservation events per 128-byte line, print the most contended lines at stop
 		cfg::set_entry load_libraries{this, "Load libraries"};
 
 	} core{this};
@@ -322,6 +333,7 @@ struct cfg_root : cfg::node
 		cfg::string app_home{this, "/app_home/"}; // Not mounted
 
 		cfg::_bool host_root{this, "Enable /host_root/"};
+		cfg::_bool read_ahead{this, "Asynchronous Read-Ahead"}; // Prefetch sequentially read files in background
 
 	} vfs{this};
 
@@ -375,6 +387,7 @@ struct cfg_root : cfg::node
 			cfg::string adapter{this, "Adapter"};
 			cfg::_bool force_fifo{this, "Force FIFO present mode"};
 			cfg::_bool force_primitive_restart{this, "Force primitive restart flag"};
+			cfg::_bool async_pipeline_compile{this, "Asynchronous Pipeline Compilation", false};
 
 		} vk{this};
 
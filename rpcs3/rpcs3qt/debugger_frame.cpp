@@ -9,6 +9,7 @@
 
 constexpr auto qstr = QString::fromStdString;
 extern bool user_asked_for_frame_capture;
+extern bool user_asked_for_frame_replay;
 
 debugger_frame::debugger_frame(std::shared_ptr<gui_settings> settings, QWidget *parent)
 	: custom_dock_widget(tr("Debugger"), parent), xgui_settings(settings)
@@ -47,6 +48,7 @@ debugger_frame::debugger_frame(std::shared_ptr<gui_settings> settings, QWidget *
 	m_go_to_addr = new QPushButton(tr("Go To Address"), this);
 	m_go_to_pc = new QPushButton(tr("Go To PC"), this);
 	m_btn_capture = new QPushButton(tr("Capture"), this);
+	m_btn_replay = new QPushButton(tr("Replay Capture"), this);
 	m_btn_step = new QPushButton(tr("Step"), this);
 	m_btn_step_over = new QPushButton(tr("Step Over"), this);
 	m_btn_run = new QPushButton(RunString, this);
@@ -58,6 +60,7 @@ debugger_frame::debugger_frame(std::shared_ptr<gui_settings> settings, QWidget *
 	hbox_b_main->addWidget(m_go_to_addr);
 	hbox_b_main->addWidget(m_go_to_pc);
 	hbox_b_main->addWidget(m_btn_capture);
+	hbox_b_main->addWidget(m_btn_replay);
 	hbox_b_main->addWidget(m_btn_step);
 	hbox_b_main->addWidget(m_btn_step_over);
 	hbox_b_main->addWidget(m_btn_run);
@@ -107,6 +110,11 @@ debugger_frame::debugger_frame(std::shared_ptr<gui_settings> settings, QWidget *
 		user_asked_for_frame_capture = true;
 	});
 
+	connect(m_btn_replay, &QAbstractButton::clicked, [=]()
+	{
+		user_asked_for_frame_replay = true;
+	});
+
 	connect(m_btn_step, &QAbstractButton::clicked, this, &debugger_frame::DoStep);
 	connect(m_btn_step_over, &QAbstractButton::clicked, [=]() { DoStep(true); });
 